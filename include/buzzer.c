@@ -18,8 +18,12 @@
 //                              |
 //                             GND
 
+#ifdef OLED_SPI
+#define BUZZER_PIN P10           // P1.0 - Buzzer, P1.5 is MOSI of the SPI OLED
+#else
 #define BUZZER_PIN P15           // P1.5 - Buzzer
-SBIT(BUZZER, 0x90, BUZZER_PIN);  // P1.5
+#endif
+SBIT(BUZZER, 0x90, BUZZER_PIN);  // P1.x
 
 // The length of half period of notes in µs.
 // -> 1,000,000µs / Note_Frequency / 2
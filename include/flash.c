@@ -0,0 +1,86 @@
+//
+// CH552 Data Flash library
+//
+
+#include "flash.h"
+
+#include <ch554.h>
+
+inline void flash_write_enable()
+{
+    SAFE_MOD = 0x55;
+    SAFE_MOD = 0xAA;
+    GLOBAL_CFG |= bDATA_WE;
+    SAFE_MOD = 0x00;
+}
+
+inline void flash_write_protect()
+{
+    SAFE_MOD = 0x55;
+    SAFE_MOD = 0xAA;
+    GLOBAL_CFG &= ~bDATA_WE;
+    SAFE_MOD = 0x00;
+}
+
+uint8_t flash_read(uint8_t addr)
+{
+    ROM_ADDR_H = DATA_FLASH_ADDR >> 8;
+    ROM_ADDR_L = addr << 1;
+    ROM_CTRL   = ROM_CMD_READ;
+
+    return ROM_DATA_L;
+}
+
+// Write a byte with the write protection already lifted, return 1 on success.
+__bit flash_program(uint8_t addr, uint8_t data)
+{
+    ROM_ADDR_H = DATA_FLASH_ADDR >> 8;
+    ROM_ADDR_L = addr << 1;
+    ROM_DATA_L = data;
+    if ((ROM_STATUS & bROM_ADDR_OK) == 0)
+    {
+        return 0;
+    }
+    ROM_CTRL = ROM_CMD_WRITE;  // The MCU halts until the byte is written
+
+    return (ROM_STATUS & (bROM_ADDR_OK | bROM_CMD_ERR)) == bROM_ADDR_OK;
+}
+
+__bit flash_write(uint8_t addr, uint8_t data)
+{
+    __bit ok;
+
+    flash_write_enable();
+    ok = flash_program(addr, data);
+    flash_write_protect();
+
+    return ok;
+}
+
+void flash_read_block(uint8_t addr, __xdata uint8_t* buf, uint8_t len)
+{
+    while (len--)
+    {
+        *buf++ = flash_read(addr++);
+    }
+}
+
+// Write a block, bytes that already hold the data are skipped to spare the flash.
+__bit flash_write_block(uint8_t addr, __xdata const uint8_t* buf, uint8_t len)
+{
+    __bit ok = 1;
+
+    flash_write_enable();
+    while (len-- && ok)
+    {
+        if (flash_read(addr) != *buf)
+        {
+            ok = flash_program(addr, *buf);
+        }
+        addr++;
+        buf++;
+    }
+    flash_write_protect();
+
+    return ok;
+}
@@ -0,0 +1,21 @@
+//
+// CH552 Data Flash library
+//
+// 128 bytes of non-volatile data at DATA_FLASH_ADDR, read and written byte by byte.
+// - Every byte is mapped to an even flash-ROM address, i.e. DATA_FLASH_ADDR + addr x 2.
+// - A byte write does not need an erase, the MCU halts until the write completes.
+//
+// References
+// - CH552 datasheet, 6.2 Flash-ROM and Data Flash
+//
+
+#pragma once
+
+#include <stdint.h>
+
+#define DATA_FLASH_SIZE 128
+
+uint8_t flash_read(uint8_t addr);
+__bit   flash_write(uint8_t addr, uint8_t data);
+void    flash_read_block(uint8_t addr, __xdata uint8_t* buf, uint8_t len);
+__bit   flash_write_block(uint8_t addr, __xdata const uint8_t* buf, uint8_t len);
@@ -9,4 +9,15 @@ typedef struct OLED_font
     uint8_t         height;   // Font height in OLED pages (8 pixels per page)
     uint8_t         spacing;  // Character spacing
     uint8_t         first;    // The code point of the first character
+    void (*plot)(char c);     // Specialized renderer, 0 for the generic one
 } OLED_font;
+
+// Renderers specialized for the fonts, see OLED_RENDERER() in oled.c
+// - Called through the plot pointer, so a single argument passed in DPL. SDCC passes
+//   further arguments of a non-reentrant function in its static _PARM_ variables,
+//   which a call through a pointer cannot fill. The renderers read _font->data.
+void OLED_plot5x8(char c);
+void OLED_plot8x16(char c);
+
+// Renderer of the column-RLE compressed fonts, see font_12x24.h
+void OLED_plotRLE(char c);
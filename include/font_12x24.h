@@ -0,0 +1,61 @@
+#pragma once
+
+#include "font.h"
+
+// Big numerals for the primary reading, column-RLE compressed, see OLED_plotRLE()
+// - ' ' to '9', digits, '-' and '.' in a seven-segment style, the other glyphs share
+//   one blank stream.
+// - A glyph is 12 columns of 3 bytes in vertical addressing order, 36 bytes sent, 398
+//   bytes of data for the 26 glyphs instead of 936 uncompressed.
+// - Tokens: 0x80 | n, n bytes of 0x00; 0xC0 | n, n bytes of 0xFF; n, n literal bytes
+//   follow. n is at most 32, a token never spans 2 I2C chunks.
+__code uint8_t _OLED_FONT_12x24[] = {
+    // Offset of each glyph stream from the start of the data, little-endian
+    0x34, 0x00, 0x34, 0x00, 0x34, 0x00, 0x34, 0x00, 0x34, 0x00, 0x34, 0x00, 0x34, 0x00, 0x34, 0x00,  // ' ' ! " # $ % & '
+    0x34, 0x00, 0x34, 0x00, 0x34, 0x00, 0x34, 0x00, 0x34, 0x00, 0x36, 0x00, 0x4F, 0x00, 0x34, 0x00,  // ( ) * + , - . /
+    0x59, 0x00, 0x7A, 0x00, 0x86, 0x00, 0xA7, 0x00, 0xC8, 0x00, 0xE9, 0x00, 0x0A, 0x01, 0x2B, 0x01,  // 0 1 2 3 4 5 6 7
+    0x4C, 0x01, 0x6D, 0x01,  // 8 9
+
+    // Glyph streams
+    0xA0, 0x84,  // blank, shared by the unused glyphs
+    0x87, 0x01, 0x1C, 0x82, 0x01, 0x1C, 0x82, 0x01, 0x1C, 0x82, 0x01, 0x1C, 0x82, 0x01, 0x1C, 0x82,  // - 13
+    0x01, 0x1C, 0x82, 0x01, 0x1C, 0x82, 0x01, 0x1C, 0x87,
+    0x8E, 0x01, 0x70, 0x82, 0x01, 0x70, 0x82, 0x01, 0x70, 0x8F,  // . 14
+    0x83, 0x1E, 0xFC, 0xFF, 0x3F, 0xFE, 0xFF, 0x7F, 0xFE, 0xFF, 0x7F, 0x0E, 0x00, 0x70, 0x0E, 0x00,  // 0 16
+    0x70, 0x0E, 0x00, 0x70, 0x0E, 0x00, 0x70, 0xFE, 0xFF, 0x7F, 0xFE, 0xFF, 0x7F, 0xFC, 0xFF, 0x3F,
+    0x83,
+    0x98, 0x09, 0xFE, 0xFF, 0x7F, 0xFE, 0xFF, 0x7F, 0xFC, 0xFF, 0x3F, 0x83,  // 1 17
+    0x83, 0x1E, 0x0C, 0xFC, 0x3F, 0x0E, 0xFC, 0x7F, 0x0E, 0xFC, 0x7F, 0x0E, 0x1C, 0x70, 0x0E, 0x1C,  // 2 18
+    0x70, 0x0E, 0x1C, 0x70, 0x0E, 0x1C, 0x70, 0xFE, 0x1F, 0x70, 0xFE, 0x1F, 0x70, 0xFC, 0x1F, 0x30,
+    0x83,
+    0x83, 0x1E, 0x0C, 0x1C, 0x30, 0x0E, 0x1C, 0x70, 0x0E, 0x1C, 0x70, 0x0E, 0x1C, 0x70, 0x0E, 0x1C,  // 3 19
+    0x70, 0x0E, 0x1C, 0x70, 0x0E, 0x1C, 0x70, 0xFE, 0xFF, 0x7F, 0xFE, 0xFF, 0x7F, 0xFC, 0xFF, 0x3F,
+    0x83,
+    0x83, 0x08, 0xFC, 0x1F, 0x00, 0xFE, 0x1F, 0x00, 0xFE, 0x1F, 0x82, 0x01, 0x1C, 0x82, 0x01, 0x1C,  // 4 20
+    0x82, 0x01, 0x1C, 0x82, 0x0B, 0x1C, 0x00, 0xFE, 0xFF, 0x7F, 0xFE, 0xFF, 0x7F, 0xFC, 0xFF, 0x3F,
+    0x83,
+    0x83, 0x1E, 0xFC, 0x1F, 0x30, 0xFE, 0x1F, 0x70, 0xFE, 0x1F, 0x70, 0x0E, 0x1C, 0x70, 0x0E, 0x1C,  // 5 21
+    0x70, 0x0E, 0x1C, 0x70, 0x0E, 0x1C, 0x70, 0x0E, 0xFC, 0x7F, 0x0E, 0xFC, 0x7F, 0x0C, 0xFC, 0x3F,
+    0x83,
+    0x83, 0x1E, 0xFC, 0xFF, 0x3F, 0xFE, 0xFF, 0x7F, 0xFE, 0xFF, 0x7F, 0x0E, 0x1C, 0x70, 0x0E, 0x1C,  // 6 22
+    0x70, 0x0E, 0x1C, 0x70, 0x0E, 0x1C, 0x70, 0x0E, 0xFC, 0x7F, 0x0E, 0xFC, 0x7F, 0x0C, 0xFC, 0x3F,
+    0x83,
+    0x83, 0x01, 0x0C, 0x82, 0x01, 0x0E, 0x82, 0x01, 0x0E, 0x82, 0x01, 0x0E, 0x82, 0x01, 0x0E, 0x82,  // 7 23
+    0x01, 0x0E, 0x82, 0x01, 0x0E, 0x82, 0x09, 0xFE, 0xFF, 0x7F, 0xFE, 0xFF, 0x7F, 0xFC, 0xFF, 0x3F,
+    0x83,
+    0x83, 0x1E, 0xFC, 0xFF, 0x3F, 0xFE, 0xFF, 0x7F, 0xFE, 0xFF, 0x7F, 0x0E, 0x1C, 0x70, 0x0E, 0x1C,  // 8 24
+    0x70, 0x0E, 0x1C, 0x70, 0x0E, 0x1C, 0x70, 0xFE, 0xFF, 0x7F, 0xFE, 0xFF, 0x7F, 0xFC, 0xFF, 0x3F,
+    0x83,
+    0x83, 0x1E, 0xFC, 0x1F, 0x30, 0xFE, 0x1F, 0x70, 0xFE, 0x1F, 0x70, 0x0E, 0x1C, 0x70, 0x0E, 0x1C,  // 9 25
+    0x70, 0x0E, 0x1C, 0x70, 0x0E, 0x1C, 0x70, 0xFE, 0xFF, 0x7F, 0xFE, 0xFF, 0x7F, 0xFC, 0xFF, 0x3F,
+    0x83,
+};
+
+__code OLED_font OLED_FONT_12x24 = {
+    (uint8_t *)_OLED_FONT_12x24,
+    12,  // Font width in pixels
+    3,   // Font height in OLED pages (8 pixels per page)
+    0,   // Character spacing
+    32,  // The code point of the first character
+    OLED_plotRLE,
+};
@@ -107,4 +107,5 @@ __code OLED_font OLED_FONT_5x8 = {
     1,   // Font height in OLED pages (8 pixels per page)
     1,   // Character spacing
     32,  // The code point of the first character
+    OLED_plot5x8,
 };
@@ -108,4 +108,5 @@ __code OLED_font OLED_FONT_8x16 = {
     2,   // Font height in OLED pages (8 pixels per page)
     0,   // Character spacing
     32,  // The code point of the first character
+    OLED_plot8x16,
 };
@@ -3,8 +3,17 @@
 // ===================================================================================
 //
 // Simple I2C bitbanging for 400kHz slave devices. For system clock < 12MHz the 
-// I2C clock frequency is slower. ACK bit of the slave is ignored. Clock stretching 
-// by the slave is not allowed.
+// I2C clock frequency is slower. A NAK of the slave is flagged, see I2C_nak() and
+// I2C_recover(). Clock stretching by the slave is not allowed.
+//
+// I2C_write() and I2C_read() are inline assembly byte engines with per-device
+// timing profiles, see I2C_set_timing(). They access SDA and SCL as bits of P1 or
+// P3, see PIN_SDA and PIN_SCL.
+//
+// Transactions posted with I2C_post_start() ... I2C_post_stop() are queued and run
+// in the background by the timer2 interrupt, one byte per tick. The blocking
+// functions wait for the queue to reach a transaction boundary and hold it from
+// I2C_start() to I2C_stop().
 //
 // PIN_SDA and PIN_SCL must be defined in config.h:
 // PIN_SDA - pin connected to serial data of the I2C bus
@@ -15,6 +24,7 @@
 // 2022 by Stefan Wagner:   https://github.com/wagiminator
 
 #include "i2c.h"
+#include "ch554.h"
 #include "gpio.h"
 // #include "config.h"
 
@@ -46,9 +56,14 @@
 // #ifndef PIN_SCL
 //   #error PIN_SCL is undefined
 // #endif
-// I2C pins
+// I2C pins, P1.7 is SCK of the hardware SPI0 with the SPI OLED, see oled.c
+#ifdef OLED_SPI
+#define PIN_SDA P13  // I2C SDA
+#define PIN_SCL P12  // I2C SCL
+#else
 #define PIN_SDA P17  // I2C SDA
 #define PIN_SCL P16  // I2C SCL
+#endif
 
 // I2C macros
 #define I2C_SDA_HIGH()  PIN_high(PIN_SDA) // release SDA -> pulled HIGH by resistor
@@ -58,66 +73,457 @@
 #define I2C_SDA_READ()  PIN_read(PIN_SDA) // read SDA pin
 #define I2C_CLOCKOUT()  I2C_DELAY_L();I2C_SCL_HIGH();I2C_DELAY_H();I2C_DELAY_H();I2C_SCL_LOW()
 
+// Timing profiles, selected per device with I2C_set_timing() before I2C_start()
+// The byte engines shift the bits through the carry and write / read the
+// bit-addressable SDA and SCL pins directly, padded by loops of "djnz r6, ." with
+// at least 1 loop. Counted with the CH552 instruction cycles
+// (bit operations 2, mov 2, rlc 1, taken djnz 3), a bit takes 14 + 3 x (LOW loops +
+// HIGH loops) cycles, SCL is LOW for about 8 + 3 x LOW and HIGH for 4 + 3 x HIGH.
+// - I2C_TIMING_FAST      400kHz fast mode, SCL LOW >= 1.3us, HIGH >= 0.6us, bit >= 2.5us.
+// - I2C_TIMING_FAST_PLUS 1MHz fast mode plus, LOW >= 0.5us, HIGH >= 0.26us, bit >= 1us.
+// - I2C_TIMING_HS        High-speed mode, e.g. INA219 up to 2.56MHz. I2C_start() sends
+//                        the master code at fast mode timing, then the transaction runs
+//                        on the unpadded engine until I2C_stop(), a bit takes 10 cycles
+//                        (13 at 32MHz to stay below 2.56MHz).
+//   FREQ_SYS          FAST              FAST_PLUS             HS
+//               LOW HIGH  rate       LOW HIGH  rate        rate
+//     32 MHz     15   8   386 kHz     4   3   914 kHz     2.46 MHz
+//     24 MHz     11   5   387 kHz     2   2   923 kHz     2.40 MHz
+//     16 MHz      6   3   390 kHz     1   1   800 kHz     1.60 MHz
+//     12 MHz      4   2   375 kHz     1   1   600 kHz     1.20 MHz
+//      6 MHz      1   1   300 kHz     1   1   300 kHz      600 kHz
+//      3 MHz      1   1   150 kHz     1   1   150 kHz      300 kHz
+// The faster profiles rely on short rise times, size the pull-up resistors for the
+// bus capacitance.
+#if FREQ_SYS >= 32000000
+__code const uint8_t I2C_LOOPS[][2] = {{15, 8}, {4, 3}, {15, 8}};  // {LOW, HIGH}, see I2C_TIMING_*
+#elif FREQ_SYS >= 24000000
+__code const uint8_t I2C_LOOPS[][2] = {{11, 5}, {2, 2}, {11, 5}};
+#elif FREQ_SYS >= 16000000
+__code const uint8_t I2C_LOOPS[][2] = {{6, 3}, {1, 1}, {6, 3}};
+#elif FREQ_SYS >= 12000000
+__code const uint8_t I2C_LOOPS[][2] = {{4, 2}, {1, 1}, {4, 2}};
+#else
+__code const uint8_t I2C_LOOPS[][2] = {{1, 1}, {1, 1}, {1, 1}};
+#endif
+
+#define I2C_HS_MASTER_CODE 0x08             // 00001xxx, not acknowledged by any slave
+
+// Queue tick, the timer2 interrupt transfers one byte per tick. A FAST byte takes
+// about 25us, so at 50us roughly half of the CPU goes to the bus while it is busy.
+#define I2C_QUEUE_TICK_us  50
+#define I2C_QUEUE_RELOAD   ((uint16_t)(65536 - (uint32_t)FREQ_SYS / 12 * I2C_QUEUE_TICK_us / 1000000))
+
+__data uint8_t _I2C_TIMING  = I2C_TIMING_FAST;
+__data uint8_t _I2C_LOOPS_L = 1;            // LOW padding of the engine, see I2C_LOOPS
+__data uint8_t _I2C_LOOPS_H = 1;            // HIGH padding of the engine, see I2C_LOOPS
+__bit          _I2C_HS      = 0;            // The bus is in high-speed mode, unpadded engine
+
+// Select the timing profile of the following transactions, see I2C_TIMING_*
+void I2C_set_timing(uint8_t timing) {
+  _I2C_TIMING  = timing;
+  _I2C_LOOPS_L = I2C_LOOPS[timing][0];
+  _I2C_LOOPS_H = I2C_LOOPS[timing][1];
+}
+
 // I2C init function
 void I2C_init(void) {
   PIN_output_OD(PIN_SDA);                   // set SDA pin to open-drain OUTPUT
   PIN_output_OD(PIN_SCL);                   // set SCL pin to open-drain OUTPUT
+  I2C_set_timing(I2C_TIMING_FAST);          // default timing profile
+  RCAP2L = (uint8_t)I2C_QUEUE_RELOAD;       // timer2 at Fsys/12, auto-reload every tick
+  RCAP2H = (uint8_t)(I2C_QUEUE_RELOAD >> 8);
+  TL2    = RCAP2L;
+  TH2    = RCAP2H;
+  ET2    = 1;                               // enable timer2 interrupt, see I2C_queue_interrupt()
 }
 
-// I2C transmit one data byte to the slave, ignore ACK bit, no clock stretching allowed
-void I2C_write(uint8_t data) {
-  uint8_t i;
-  for(i=8; i; i--, data<<=1) {              // transmit 8 bits, MSB first
-    (data & 0x80) ? (I2C_SDA_HIGH()) : (I2C_SDA_LOW());  // SDA HIGH if bit is 1
-    I2C_CLOCKOUT();                         // clock out -> slave reads the bit
-  }
-  I2C_SDA_HIGH();                           // release SDA for ACK bit of slave
-  I2C_DELAY_H();                            // delay
-  I2C_DELAY_H();                            // delay
-  I2C_CLOCKOUT();                           // 9th clock pulse is for the ignored ACK bit
-}
+__bit _I2C_NAK = 0;                         // a byte was not acknowledged since I2C_start()
 
-// I2C start transmission
-void I2C_start(uint8_t addr) {
+// I2C start condition and slave address
+void I2C_begin(uint8_t addr) {
   I2C_SDA_LOW();                            // start condition: SDA goes LOW first
   I2C_DELAY_H();                            // delay
   I2C_SCL_LOW();                            // start condition: SCL goes LOW second
   I2C_write(addr);                          // send slave address
 }
 
-// I2C restart transmission
+// Transaction queue, an entry is an operation and its data byte.
+// - The ring has 256 entries, the uint8_t head and tail wrap around by themselves.
+// - The main loop posts at the head and waits only when the ring is full, the
+//   interrupt runs from the tail and keeps its own engine state, see I2C_queue_run().
+#define I2C_QUEUE_OP_WRITE 0x00             // data byte
+#define I2C_QUEUE_OP_STOP  0x01             // stop condition
+#define I2C_QUEUE_OP_START 0x80             // | timing profile, data = slave address
+
+__xdata uint8_t _I2C_QUEUE_OPS[256];
+__xdata uint8_t _I2C_QUEUE_DATA[256];
+__data volatile uint8_t _I2C_QUEUE_HEAD = 0; // next free entry, written by the main loop
+__data volatile uint8_t _I2C_QUEUE_TAIL = 0; // next entry to run, written by the interrupt
+volatile __bit _I2C_QUEUE_OPEN = 0;         // the queue is in the middle of a transaction
+volatile __bit _I2C_QUEUE_HOLD = 0;         // a blocking transaction waits or runs
+__data uint8_t  _I2C_QUEUE_TIMING = I2C_TIMING_FAST;
+__bit           _I2C_QUEUE_HS     = 0;
+__bit           _I2C_QUEUE_NAK    = 0;
+__data uint16_t _I2C_QUEUE_ERRORS = 0;      // queued transactions with a NAK
+
+// I2C start condition, master code in high-speed mode and slave address, clears the NAK flag
+// - With I2C_TIMING_HS, the master code is sent first to enter high-speed mode, its
+//   NAK is expected. The slave stays in high-speed mode until I2C_stop().
+void I2C_open(uint8_t addr) {
+  _I2C_NAK = 0;
+  if(_I2C_TIMING == I2C_TIMING_HS) {
+    I2C_begin(I2C_HS_MASTER_CODE);          // master code at fast mode timing
+    _I2C_NAK = 0;                           // NAK of the master code is expected
+    _I2C_HS  = 1;                           // unpadded engine from now on
+    I2C_restart(addr);                      // address at high-speed timing
+    return;
+  }
+  I2C_begin(addr);
+}
+
+// I2C restart transmission, keeps the NAK flag of the transaction
 void I2C_restart(uint8_t addr) {
   I2C_SDA_HIGH();                           // prepare SDA for HIGH to LOW transition
   I2C_DELAY_H();                            // delay
   I2C_SCL_HIGH();                           // restart condition: clock HIGH
-  I2C_start(addr);                          // start again
+  I2C_begin(addr);                          // start again
 }
 
-// I2C stop transmission
-void I2C_stop(void) {
+// I2C stop condition
+void I2C_end(void) {
   I2C_SDA_LOW();                            // prepare SDA for LOW to HIGH transition
   I2C_DELAY_H();                            // delay
   I2C_SCL_HIGH();                           // stop condition: SCL goes HIGH first
   I2C_DELAY_H();                            // delay
   I2C_SDA_HIGH();                           // stop condition: SDA goes HIGH second
+  _I2C_HS = 0;                              // slaves return to fast mode after stop
 }
 
-// I2C receive one data byte from the slave (ack=0 for last byte, ack>0 if more bytes to follow)
-uint8_t I2C_read(uint8_t ack) {
+// I2C bus recovery
+// A slave may still hold SDA LOW in the middle of a byte, e.g. after a glitch on
+// SCL. Clock it out with up to 9 clock pulses until SDA is released, then
+// terminate with a stop condition.
+void I2C_clear_bus(void) {
   uint8_t i;
-  uint8_t data = 0;                         // variable for the received byte
-  I2C_SDA_HIGH();                           // release SDA -> will be toggled by slave
-  for(i=8; i; i--) {                        // receive 8 bits
-    data <<= 1;                             // bits shifted in right (MSB first)
+  I2C_SDA_HIGH();                           // release SDA
+  for(i=9; i && !I2C_SDA_READ(); i--) {     // clock until the slave releases SDA
     I2C_DELAY_H();                          // delay
-    I2C_DELAY_L();                          // delay
-    I2C_SCL_HIGH();                         // clock HIGH
-    if(I2C_SDA_READ()) data |= 1;           // read bit
-    I2C_SCL_LOW();                          // clock LOW -> slave prepares next bit
+    I2C_CLOCKOUT();                         // clock out -> slave shifts out a bit
   }
-  if(ack) I2C_SDA_LOW();                    // pull SDA LOW to acknowledge (ACK)
-  I2C_DELAY_H();                            // delay
-  I2C_DELAY_H();                            // delay
-  I2C_CLOCKOUT();                           // clock out -> slave reads ACK bit
-  return data;                              // return the received byte
+  I2C_end();                                // stop condition resets the slave state
+}
+
+// Run the queue until a byte is transferred, the queue is empty, or a blocking
+// transaction holds it at a transaction boundary
+void I2C_queue_process(void) {
+  uint8_t i, op, data;
+  while(_I2C_QUEUE_TAIL != _I2C_QUEUE_HEAD) {
+    i  = _I2C_QUEUE_TAIL;
+    op = _I2C_QUEUE_OPS[i];
+    if(op & I2C_QUEUE_OP_START) {
+      if(_I2C_QUEUE_HOLD) return;           // wait for I2C_stop() of the blocking transaction
+      _I2C_QUEUE_TIMING = op & ~I2C_QUEUE_OP_START;
+      I2C_set_timing(_I2C_QUEUE_TIMING);
+      _I2C_QUEUE_OPEN = 1;
+    }
+    data = _I2C_QUEUE_DATA[i];              // read before the entry is released
+    _I2C_QUEUE_TAIL = i + 1;
+    if(op == I2C_QUEUE_OP_STOP) {
+      I2C_end();
+      _I2C_QUEUE_OPEN = 0;
+      if(_I2C_NAK) {
+        _I2C_QUEUE_ERRORS++;
+        I2C_clear_bus();
+      }
+      return;
+    }
+    if(op == I2C_QUEUE_OP_WRITE) I2C_write(data);
+    else I2C_open(data);
+    return;
+  }
+}
+
+// Run one queue step with the engine state of the queue
+// The interrupt may come between I2C_set_timing() and I2C_start(), or between
+// I2C_stop() and I2C_nak() of the main loop, its state is saved and restored.
+void I2C_queue_run(void) {
+  uint8_t timing = _I2C_TIMING;
+  __bit   hs     = _I2C_HS;
+  __bit   nak    = _I2C_NAK;
+
+  I2C_set_timing(_I2C_QUEUE_TIMING);
+  _I2C_HS  = _I2C_QUEUE_HS;
+  _I2C_NAK = _I2C_QUEUE_NAK;
+  I2C_queue_process();
+  _I2C_QUEUE_HS  = _I2C_HS;
+  _I2C_QUEUE_NAK = _I2C_NAK;
+  I2C_set_timing(timing);
+  _I2C_HS  = hs;
+  _I2C_NAK = nak;
+}
+
+// Timer2 interrupt, runs the transaction queue in the background
+// A tick only stretches SCL of the queued transaction, timer0 has the higher
+// priority and keeps millis() accurate.
+void I2C_queue_interrupt(void) __interrupt(INT_NO_TMR2) {
+  TF2 = 0;                                  // the flag is not cleared by hardware
+  if(!I2C_queue_busy()) {
+    TR2 = 0;                                // idle until the next post, see I2C_post_op()
+    return;
+  }
+  if(_I2C_QUEUE_HOLD && !_I2C_QUEUE_OPEN) return;
+  I2C_queue_run();
+}
+
+// Hold the queue at a transaction boundary, the current queued transaction is
+// finished first. With interrupts disabled, e.g. during startup, the queue is run
+// by the caller.
+void I2C_lock(void) {
+  _I2C_QUEUE_HOLD = 1;
+  while(_I2C_QUEUE_OPEN) {
+    if(!EA) I2C_queue_run();
+  }
+}
+
+// Release the queue after a blocking transaction
+void I2C_unlock(void) {
+  _I2C_QUEUE_HOLD = 0;
+}
+
+// I2C start transmission, clears the NAK flag
+// Waits for the queue to reach a transaction boundary and holds it until I2C_stop().
+void I2C_start(uint8_t addr) {
+  I2C_lock();
+  I2C_open(addr);
+}
+
+// I2C stop transmission, releases the queue
+void I2C_stop(void) {
+  I2C_end();
+  I2C_unlock();
+}
+
+// I2C bus recovery, call it after a NAK
+void I2C_recover(void) {
+  I2C_lock();
+  I2C_clear_bus();
+  I2C_unlock();
+}
+
+// Queue one entry, waits while the queue is full
+void I2C_post_op(uint8_t op, uint8_t data) {
+  uint8_t i = _I2C_QUEUE_HEAD;
+  while((uint8_t)(i + 1) == _I2C_QUEUE_TAIL) {
+    if(!EA) I2C_queue_run();                // nobody else drains it
+  }
+  _I2C_QUEUE_OPS[i]  = op;
+  _I2C_QUEUE_DATA[i] = data;
+  _I2C_QUEUE_HEAD    = i + 1;               // publish the entry to the interrupt
+  TR2 = 1;                                  // wake the queue, see I2C_queue_interrupt()
+}
+
+// Queue a start condition and slave address with a timing profile, see I2C_TIMING_*
+void I2C_post_start(uint8_t addr, uint8_t timing) {
+  I2C_post_op(I2C_QUEUE_OP_START | timing, addr);
+}
+
+// Queue one data byte
+void I2C_post(uint8_t data) {
+  I2C_post_op(I2C_QUEUE_OP_WRITE, data);
+}
+
+// Queue a buffer, len = 0 queues 256 bytes
+void I2C_post_buf(const uint8_t* buf, uint8_t len) {
+  do {
+    I2C_post_op(I2C_QUEUE_OP_WRITE, *buf++);
+  } while(--len);
+}
+
+// Queue the same byte count times, count = 0 queues 256 bytes
+void I2C_post_repeat(uint8_t data, uint8_t count) {
+  do {
+    I2C_post_op(I2C_QUEUE_OP_WRITE, data);
+  } while(--count);
+}
+
+// Queue a stop condition, a NAK of the transaction is counted and the bus recovered
+void I2C_post_stop(void) {
+  I2C_post_op(I2C_QUEUE_OP_STOP, 0);
+}
+
+// Queued transactions with a NAK
+uint16_t I2C_queue_errors(void) {
+  return _I2C_QUEUE_ERRORS;
+}
+
+// I2C transmit one data byte to the slave, no clock stretching allowed
+// - data is passed in DPL, each bit is rotated into the carry and moved to SDA.
+// - The ACK bit is sampled on the 9th clock, a NAK sets _I2C_NAK, see I2C_nak().
+// - i2c_write_a is the byte engine for the buffered transfers, byte in A, uses r6, r7.
+void I2C_write(uint8_t data) __naked {
+  data;                                     // passed in DPL
+  __asm
+    mov   a, dpl
+i2c_write_a:
+    mov   r7, #8                            ; transmit 8 bits, MSB first
+    jb    __I2C_HS, 00005$
+00001$:
+    rlc   a                                 ; C = next bit
+    mov   PIN_asm(PIN_SDA), c               ; SDA = C, SCL is LOW
+    mov   r6, __I2C_LOOPS_L
+    djnz  r6, .
+    setb  PIN_asm(PIN_SCL)                  ; clock HIGH -> slave reads the bit
+    mov   r6, __I2C_LOOPS_H
+    djnz  r6, .
+    clr   PIN_asm(PIN_SCL)                  ; clock LOW
+    djnz  r7, 00001$
+    setb  PIN_asm(PIN_SDA)                  ; release SDA for ACK bit of slave
+    mov   r6, __I2C_LOOPS_L
+    djnz  r6, .
+    setb  PIN_asm(PIN_SCL)                  ; 9th clock pulse is for the ACK bit
+    mov   r6, __I2C_LOOPS_H
+    djnz  r6, .
+    sjmp  00007$
+00005$:                                     ; high-speed mode, unpadded
+    rlc   a
+    mov   PIN_asm(PIN_SDA), c
+    setb  PIN_asm(PIN_SCL)
+#if FREQ_SYS >= 32000000
+    nop
+    nop
+    nop
+#endif
+    clr   PIN_asm(PIN_SCL)
+    djnz  r7, 00005$
+    setb  PIN_asm(PIN_SDA)
+    setb  PIN_asm(PIN_SCL)
+#if FREQ_SYS >= 32000000
+    nop
+    nop
+    nop
+#endif
+00007$:
+    jnb   PIN_asm(PIN_SDA), 00004$          ; slave pulls SDA LOW to acknowledge
+    setb  __I2C_NAK
+00004$:
+    clr   PIN_asm(PIN_SCL)
+    ret
+  __endasm;
+}
+
+// I2C receive one data byte from the slave (ack=0 for last byte, ack>0 if more bytes to follow)
+// - ack is passed and the byte is returned in DPL, SDA is rotated into the byte via the carry.
+// - i2c_read_r5 is the byte engine for the buffered transfers, ack in r5, byte returned
+//   in A and DPL, uses r5, r6, r7.
+uint8_t I2C_read(uint8_t ack) __naked {
+  ack;                                      // passed in DPL
+  __asm
+    mov   r5, dpl
+i2c_read_r5:
+    setb  PIN_asm(PIN_SDA)                  ; release SDA -> will be toggled by slave
+    mov   r7, #8                            ; receive 8 bits, MSB first
+    jb    __I2C_HS, 00008$
+00002$:
+    mov   r6, __I2C_LOOPS_L
+    djnz  r6, .
+    setb  PIN_asm(PIN_SCL)                  ; clock HIGH
+    mov   r6, __I2C_LOOPS_H
+    djnz  r6, .
+    mov   c, PIN_asm(PIN_SDA)               ; read bit
+    rlc   a                                 ; bits shifted in right
+    clr   PIN_asm(PIN_SCL)                  ; clock LOW -> slave prepares next bit
+    djnz  r7, 00002$
+    xch   a, r5                             ; r5 = received byte, A = ack
+    jz    00003$
+    clr   PIN_asm(PIN_SDA)                  ; pull SDA LOW to acknowledge (ACK)
+00003$:
+    mov   r6, __I2C_LOOPS_L
+    djnz  r6, .
+    setb  PIN_asm(PIN_SCL)                  ; clock out -> slave reads ACK bit
+    mov   r6, __I2C_LOOPS_H
+    djnz  r6, .
+    sjmp  00010$
+00008$:                                     ; high-speed mode, unpadded
+    setb  PIN_asm(PIN_SCL)
+#if FREQ_SYS >= 32000000
+    nop
+    nop
+    nop
+#endif
+    mov   c, PIN_asm(PIN_SDA)
+    clr   PIN_asm(PIN_SCL)
+    rlc   a
+    djnz  r7, 00008$
+    xch   a, r5
+    jz    00009$
+    clr   PIN_asm(PIN_SDA)
+00009$:
+    setb  PIN_asm(PIN_SCL)
+#if FREQ_SYS >= 32000000
+    nop
+    nop
+    nop
+#endif
+00010$:
+    clr   PIN_asm(PIN_SCL)
+    mov   a, r5
+    mov   dpl, a
+    ret
+  __endasm;
+}
+
+// I2C transmit a buffer, len = 0 transmits 256 bytes
+// - buf is a generic pointer in DPL, DPH and B, the memory type is checked once, then
+//   the bytes are fetched by movc (__code), mov @r0 (__data / __idata) or movx (__xdata)
+//   in a loop around the byte engine, __pdata is not supported.
+void I2C_write_buf(const uint8_t* buf, uint8_t len) __naked {
+  buf;                                      // passed in DPL, DPH and B
+  len;                                      // passed in _I2C_write_buf_PARM_2
+  __asm
+    mov   r4, _I2C_write_buf_PARM_2
+    mov   a, b
+    jb    acc.7, 00012$                     ; 0x80 __code
+    jb    acc.6, 00014$                     ; 0x40 __data / __idata
+00011$:                                     ; 0x00 __xdata
+    movx  a, @dptr
+    inc   dptr
+    lcall i2c_write_a
+    djnz  r4, 00011$
+    ret
+00012$:
+    clr   a
+    movc  a, @a+dptr
+    inc   dptr
+    lcall i2c_write_a
+    djnz  r4, 00012$
+    ret
+00014$:
+    mov   r0, dpl
+00015$:
+    mov   a, @r0
+    inc   r0
+    lcall i2c_write_a
+    djnz  r4, 00015$
+    ret
+  __endasm;
+}
+
+// I2C receive len bytes (len > 0) into buf, every byte is acknowledged but the last
+void I2C_read_buf(__data uint8_t* buf, uint8_t len) __naked {
+  buf;                                      // passed in DPL
+  len;                                      // passed in _I2C_read_buf_PARM_2
+  __asm
+    mov   r0, dpl
+    mov   r4, _I2C_read_buf_PARM_2
+00031$:
+    mov   a, r4
+    dec   a
+    mov   r5, a                             ; ack = bytes to follow
+    lcall i2c_read_r5
+    mov   @r0, a
+    inc   r0
+    djnz  r4, 00031$
+    ret
+  __endasm;
 }
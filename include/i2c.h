@@ -3,8 +3,8 @@
 // ===================================================================================
 //
 // Simple I2C bitbanging for 400kHz slave devices. For system clock < 12MHz the 
-// I2C clock frequency is slower. ACK bit of the slave is ignored. Clock stretching 
-// by the slave is not allowed.
+// I2C clock frequency is slower. A NAK of the slave is flagged, see I2C_nak() and
+// I2C_recover(). Clock stretching by the slave is not allowed.
 //
 // PIN_SDA and PIN_SCL must be defined in config.h:
 // PIN_SDA - pin connected to serial data of the I2C bus
@@ -15,11 +15,59 @@
 // 2022 by Stefan Wagner:   https://github.com/wagiminator
 
 #pragma once
+#include <ch554.h>
 #include <stdint.h>
 
+// Timing profiles, see I2C_set_timing()
+#define I2C_TIMING_FAST      0  // 400kHz fast mode
+#define I2C_TIMING_FAST_PLUS 1  // 1MHz fast mode plus
+#define I2C_TIMING_HS        2  // High-speed mode, entered with the master code
+
+extern __bit _I2C_NAK;
+
+// Return 1 if a byte was not acknowledged since I2C_start(), check it after I2C_stop().
+inline __bit I2C_nak(void) {
+  return _I2C_NAK;
+}
+
 void I2C_init(void);            // I2C init function
+void I2C_set_timing(uint8_t timing); // I2C timing profile of the following transactions
 void I2C_start(uint8_t addr);   // I2C start transmission
 void I2C_restart(uint8_t addr); // I2C restart transmission
 void I2C_stop(void);            // I2C stop transmission
+void I2C_recover(void);         // I2C bus recovery after a NAK
 void I2C_write(uint8_t data);   // I2C transmit one data byte to the slave
 uint8_t I2C_read(uint8_t ack);  // I2C receive one data byte from the slave
+
+// Buffered transfers, one loop around the byte engine instead of a call per byte
+void I2C_write_buf(const uint8_t* buf, uint8_t len);    // I2C transmit a buffer
+void I2C_read_buf(__data uint8_t* buf, uint8_t len);    // I2C receive a buffer
+
+// Transaction queue, run in the background by the timer2 interrupt, see I2C_init()
+// - Timer2 only runs while transactions are queued.
+// - Post a whole transaction, I2C_post_start() ... I2C_post_stop(), before calling
+//   a blocking function, I2C_start() waits for the queued transaction to finish.
+// - Posting waits only while the queue is full.
+extern __data volatile uint8_t _I2C_QUEUE_HEAD;
+extern __data volatile uint8_t _I2C_QUEUE_TAIL;
+extern volatile __bit _I2C_QUEUE_OPEN;
+
+// Return 1 while queued transactions are pending or running
+inline __bit I2C_queue_busy(void) {
+  return _I2C_QUEUE_HEAD != _I2C_QUEUE_TAIL || _I2C_QUEUE_OPEN;
+}
+
+// Return the number of entries that can be posted without waiting
+inline uint8_t I2C_queue_free(void) {
+  return (uint8_t)(_I2C_QUEUE_TAIL - _I2C_QUEUE_HEAD - 1);
+}
+
+void I2C_post_start(uint8_t addr, uint8_t timing);      // queue start and slave address
+void I2C_post(uint8_t data);                            // queue one data byte
+void I2C_post_buf(const uint8_t* buf, uint8_t len);     // queue a buffer
+void I2C_post_repeat(uint8_t data, uint8_t count);      // queue a byte count times
+void I2C_post_stop(void);                               // queue stop, a NAK is counted
+uint16_t I2C_queue_errors(void);                        // queued transactions with a NAK
+
+// Must be visible in the file with main(), SDCC creates the interrupt vector there.
+void I2C_queue_interrupt(void) __interrupt(INT_NO_TMR2);
@@ -23,36 +23,182 @@
 // Shunt resistor 0 = 0.1 Ω
 // Shunt resistor 1 =   1 Ω
 // Shunt resistor 2 =  10 Ω
-__data uint8_t        current_uA_LSB    = INA219_CURRENT_LSB_uA_0;
-__data uint16_t       power_uW_LSB      = INA219_POWER_LSB_uW_0;
 __code const uint8_t  current_uA_LSBs[] = {INA219_CURRENT_LSB_uA_0, INA219_CURRENT_LSB_uA_1, INA219_CURRENT_LSB_uA_2};
-__code const uint16_t power_uW_LSBs[]   = {INA219_POWER_LSB_uW_0, INA219_POWER_LSB_uW_1, INA219_POWER_LSB_uW_2};
+__code const uint16_t power_divisors[]  = {INA219_POWER_DIVISOR_0, INA219_POWER_DIVISOR_1, INA219_POWER_DIVISOR_2};
+__code const uint16_t shunt_pgas[]      = {INA219_PGA_0, INA219_PGA_1, INA219_PGA_2};
+__code const uint8_t  pga_shifts[]      = {INA219_PGA_SHIFT_0, INA219_PGA_SHIFT_1, INA219_PGA_SHIFT_2};
 
+// ADC profiles, see INA219_PROFILE_*
+__code const uint16_t profile_adcs[] = {
+    INA219_CONFIG_BADC_9BIT | INA219_CONFIG_SADC_9BIT,        // INA219_PROFILE_FAST
+    INA219_CONFIG_BADC_12BIT | INA219_CONFIG_SADC_12BIT,      // INA219_PROFILE_12BIT
+    INA219_CONFIG_BADC_AVG_4 | INA219_CONFIG_SADC_AVG_4,      // INA219_PROFILE_AVG_4
+    INA219_CONFIG_BADC_AVG_16 | INA219_CONFIG_SADC_AVG_16,    // INA219_PROFILE_AVG_16
+    INA219_CONFIG_BADC_AVG_128 | INA219_CONFIG_SADC_AVG_128,  // INA219_PROFILE_PRECISE
+};
+__code const uint32_t profile_conversion_times_us[] = {84, 532, 2130, 8510, 68100};
+
+// The selected device, see INA219_select().
+__xdata INA219_device* __data _ina219;
+
+void INA219_select(__xdata INA219_device* device)
+{
+    _ina219 = device;
+}
+
+// Count a NAK, return 0 if the transaction should not be retried.
+// - The INA219 may not have received the register pointer, it is unknown now.
+__bit INA219_retry(uint8_t attempt)
+{
+    _ina219->register_pointer = INA219_REGISTER_UNKNOWN;
+    I2C_recover();
+
+    if (attempt == INA219_RETRIES)
+    {
+        _ina219->errors++;
+        _ina219->bus_error = 1;
+        return 0;
+    }
+
+    _ina219->retries++;
+    return 1;
+}
+
+// Set the register pointer, the following reads stream from this register.
+void INA219_select_register(uint8_t reg)
+{
+    I2C_set_timing(_ina219->i2c_timing);
+
+    for (uint8_t attempt = 0;; attempt++)
+    {
+        I2C_start(_ina219->addr);
+        I2C_write(reg);
+        I2C_stop();
+
+        if (!I2C_nak())
+        {
+            _ina219->register_pointer = reg;
+            _ina219->bus_error        = 0;
+            return;
+        }
+
+        if (!INA219_retry(attempt))
+        {
+            return;
+        }
+    }
+}
+
+// Read a register, the returned word is invalid if INA219_bus_error().
 uint16_t INA219_read_word(uint8_t reg)
 {
-    uint16_t word;
-    I2C_start(INA219_ADDR);
-    I2C_write(reg);
-    I2C_restart(INA219_ADDR | 1);
-    word = (I2C_read(1) << 8) | I2C_read(0);
-    I2C_stop();
+    __data uint8_t word[2];  // MSB first
+
+    I2C_set_timing(_ina219->i2c_timing);
 
-    return word;
+    for (uint8_t attempt = 0;; attempt++)
+    {
+        if (reg == _ina219->register_pointer)
+        {
+            I2C_start(_ina219->addr | 1);  // Read-only transaction
+        }
+        else
+        {
+            I2C_start(_ina219->addr);
+            I2C_write(reg);
+            I2C_restart(_ina219->addr | 1);
+        }
+        I2C_read_buf(word, 2);
+        I2C_stop();
+
+        if (!I2C_nak())
+        {
+            _ina219->register_pointer = reg;
+            _ina219->bus_error        = 0;
+            break;
+        }
+
+        if (!INA219_retry(attempt))
+        {
+            break;
+        }
+    }
+
+    return ((uint16_t)word[0] << 8) | word[1];
 }
 
 void INA219_write_word(uint8_t reg, uint16_t word)
 {
-    I2C_start(INA219_ADDR);
-    I2C_write(reg);
-    I2C_write((uint8_t)(word >> 8));    // send MSB first
-    I2C_write((uint8_t)(word & 0xFF));  // send LSB
-    I2C_stop();
+    __xdata uint8_t bytes[3];
+
+    bytes[0] = reg;
+    bytes[1] = (uint8_t)(word >> 8);    // send MSB first
+    bytes[2] = (uint8_t)(word & 0xFF);  // send LSB
+
+    I2C_set_timing(_ina219->i2c_timing);
+
+    for (uint8_t attempt = 0;; attempt++)
+    {
+        I2C_start(_ina219->addr);
+        I2C_write_buf(bytes, sizeof(bytes));
+        I2C_stop();
+
+        if (!I2C_nak())
+        {
+            _ina219->register_pointer = reg;
+            _ina219->bus_error        = 0;
+            return;
+        }
+
+        if (!INA219_retry(attempt))
+        {
+            return;
+        }
+    }
+}
+
+// Initialize the selected device with shunt 0 and the default ADC profile
+void INA219_init(uint8_t addr)
+{
+    _ina219->addr                   = addr;
+    _ina219->register_pointer       = INA219_CONFIGURATION_REGISTER;  // Power-on reset value
+    _ina219->i2c_timing             = INA219_I2C_TIMING;
+    _ina219->configuration          = INA219_CONFIG_32V_320mV_16AVG_CONTINUOUS;
+    _ina219->adc_profile            = INA219_PROFILE_AVG_16;
+    _ina219->bus_voltage_register   = 0;
+    _ina219->shunt_voltage_register = 0;
+    _ina219->trimmed_shunt_magnitude = 0;
+    _ina219->trimmed_shunt_negative  = 0;
+    _ina219->trim_gain              = 0;
+    _ina219->trim_offset            = 0;
+    _ina219->retries                = 0;
+    _ina219->errors                 = 0;
+    _ina219->bus_error              = 0;
+    INA219_switch_shunt(0);  // Writes the configuration
 }
 
-void INA219_init()
+// Select the I2C timing profile of the selected device, see I2C_TIMING_*
+void INA219_set_timing(uint8_t timing)
 {
-    INA219_write_word(INA219_CONFIGURATION_REGISTER, INA219_CONFIG_32V_320mV_16AVG_CONTINUOUS);
-    INA219_write_word(INA219_CALIBRATION_REGISTER, INA219_CALIBRATION);
+    _ina219->i2c_timing = timing;
+}
+
+// Change the operating mode, writing a new mode also clears CNVR.
+void INA219_set_mode(uint8_t mode)
+{
+    _ina219->configuration = (_ina219->configuration & ~INA219_CONFIG_MODE_MASK) | mode;
+    INA219_write_word(INA219_CONFIGURATION_REGISTER, _ina219->configuration);
+}
+
+// Shunt-only streaming
+// - Switch to shunt voltage continuous mode and leave the register pointer on the
+//   shunt voltage register, so every sample is a single read-only transaction.
+// - The bus voltage register keeps the last converted value until the mode is set
+//   back to INA219_CONFIG_MODE_BOTH_CONTINUOUS.
+void INA219_start_shunt_stream()
+{
+    INA219_set_mode(INA219_CONFIG_MODE_SHUNT_CONTINUOUS);
+    INA219_select_register(INA219_SHUNT_VOLTAGE_REGISTER);
 }
 
 inline uint16_t INA219_get_raw_shunt_voltage()
@@ -75,28 +221,189 @@ inline uint16_t INA219_get_raw_current()
     return INA219_read_word(INA219_CURRENT_REGISTER);
 }
 
+// 16 x 8 bit unsigned multiply of two 8 x 8 bit MUL AB, see Calibration 10.
+inline uint32_t INA219_mul16x8(uint16_t a, uint8_t b)
+{
+    return ((uint32_t)(uint16_t)((uint8_t)(a >> 8) * b) << 8) + (uint16_t)((uint8_t)a * b);
+}
+
+// Apply the sign of the trimmed shunt voltage register to a scaled magnitude
+inline int32_t INA219_apply_sign(uint32_t magnitude)
+{
+    return _ina219->trimmed_shunt_negative ? -(int32_t)magnitude : (int32_t)magnitude;
+}
+
+// Read the shunt voltage register and apply the trim, see Calibration 9.
 int32_t INA219_get_shunt_voltage_uV()
 {
-    return (int16_t)INA219_get_raw_shunt_voltage() * (int32_t)INA219_SHUNT_VOLTAGE_LSB_uV;
+    uint16_t raw  = INA219_get_raw_shunt_voltage();
+    int16_t  gain = _ina219->trim_gain;
+    int32_t  shunt;
+    uint16_t magnitude;
+    uint16_t delta;
+
+    if (!_ina219->bus_error)  // Keep the last register if the read failed
+    {
+        _ina219->shunt_voltage_register = (int16_t)raw;
+    }
+
+    shunt                           = (int32_t)_ina219->shunt_voltage_register - _ina219->trim_offset;
+    _ina219->trimmed_shunt_negative = shunt < 0;
+    magnitude                       = (uint16_t)(shunt < 0 ? -shunt : shunt);
+
+    if (gain)
+    {
+        // Magnitude x |Gain| >> 15, |Gain| <= INA219_TRIM_GAIN_MAX has 12 bits.
+        if (gain < 0)
+        {
+            gain = -gain;
+        }
+        delta = (uint16_t)(((INA219_mul16x8(magnitude, (uint8_t)gain) >> 8) +
+                            INA219_mul16x8(magnitude, (uint8_t)((uint16_t)gain >> 8))) >>
+                           7);
+        magnitude = _ina219->trim_gain < 0 ? magnitude - delta : magnitude + delta;
+    }
+    _ina219->trimmed_shunt_magnitude = magnitude;
+
+    return INA219_apply_sign(INA219_mul16x8(magnitude, INA219_SHUNT_VOLTAGE_LSB_uV));
 }
 
 int32_t INA219_get_bus_voltage_mV()
 {
-    return (INA219_get_raw_bus_voltage() >> 3) * (int32_t)INA219_BUS_VOLTAGE_LSB_mV;
+    uint16_t bus = INA219_get_raw_bus_voltage();
+
+    if (!_ina219->bus_error)  // Keep the last register if the read failed
+    {
+        _ina219->bus_voltage_register = bus;
+    }
+    return INA219_get_latched_bus_voltage_mV();
+}
+
+// Bus_Register x |Shunt_Register| of the latest registers, no I2C transaction.
+// - A 16 x 16 bit product of 4 MUL AB. Power_uW is the product x 2 / the power divisor
+//   of the shunt, see Calibration 4., the costly division is left to the caller.
+uint32_t INA219_get_power_product()
+{
+    uint16_t bus   = _ina219->bus_voltage_register >> 3;
+    uint16_t shunt = _ina219->trimmed_shunt_magnitude;
+
+    return (INA219_mul16x8(shunt, (uint8_t)(bus >> 8)) << 8) + INA219_mul16x8(shunt, (uint8_t)bus);
 }
 
-int32_t INA219_get_power_uW()
+// The power divisor of a shunt, see Calibration 4.
+uint16_t INA219_get_power_divisor(uint8_t shunt)
 {
-    return (int16_t)INA219_get_raw_power() * (int32_t)power_uW_LSB;
+    return power_divisors[shunt];
 }
 
+// Current derived from the latest shunt voltage register, no I2C transaction.
 int32_t INA219_get_current_uA()
 {
-    return (int16_t)INA219_get_raw_current() * (int32_t)current_uA_LSB;
+    if (_ina219->current_uA_LSB == 1)  // Shunt 2, no multiply
+    {
+        return INA219_apply_sign(_ina219->trimmed_shunt_magnitude);
+    }
+
+    return INA219_apply_sign(INA219_mul16x8(_ina219->trimmed_shunt_magnitude, _ina219->current_uA_LSB));
+}
+
+// Poll the Conversion Ready (CNVR) bit
+// - Return 1 if a new conversion cycle has completed since the power register was last read.
+// - The bus voltage of the conversion is latched, see INA219_get_latched_bus_voltage_mV().
+// - Call INA219_clear_conversion_ready() after the conversion is consumed.
+// - Return 0 if the read failed, the latched bus voltage is kept.
+__bit INA219_conversion_ready()
+{
+    uint16_t bus = INA219_get_raw_bus_voltage();
+
+    if (_ina219->bus_error)
+    {
+        return 0;
+    }
+
+    _ina219->bus_voltage_register = bus;
+    return (bus & INA219_BUS_VOLTAGE_CONVERSION_READY) != 0;
+}
+
+// Clear CNVR by reading the power register, the content is discarded.
+void INA219_clear_conversion_ready()
+{
+    INA219_get_raw_power();
 }
 
+int32_t INA219_get_latched_bus_voltage_mV()
+{
+    // (Register >> 3) x INA219_BUS_VOLTAGE_LSB_mV in 16 bits, no 32-bit multiply.
+    return (uint16_t)(_ina219->bus_voltage_register >> 1) & 0xFFFC;
+}
+
+// Switch the PGA gain and the LSBs of the shunt in one go
+// - The configuration is written first, which restarts the conversion in the new range
+//   and clears CNVR, so no conversion of the previous range is read with the new LSBs.
 void INA219_switch_shunt(uint8_t shunt)
 {
-    power_uW_LSB   = power_uW_LSBs[shunt];
-    current_uA_LSB = current_uA_LSBs[shunt];
+    _ina219->shunt         = shunt;
+    _ina219->configuration = (_ina219->configuration & ~INA219_CONFIG_PG_MASK) | shunt_pgas[shunt];
+    INA219_write_word(INA219_CONFIGURATION_REGISTER, _ina219->configuration);
+
+    _ina219->power_divisor  = power_divisors[shunt];
+    _ina219->current_uA_LSB = current_uA_LSBs[shunt];
+    _ina219->pga_shift      = pga_shifts[shunt];
+}
+
+// Select the ADC profile, the conversion restarts and CNVR is cleared.
+void INA219_set_profile(uint8_t new_profile)
+{
+    _ina219->adc_profile   = new_profile;
+    _ina219->configuration = (_ina219->configuration & ~(INA219_CONFIG_BADC_MASK | INA219_CONFIG_SADC_MASK)) |
+                             profile_adcs[new_profile];
+    INA219_write_word(INA219_CONFIGURATION_REGISTER, _ina219->configuration);
+}
+
+// The time of a conversion cycle in the active ADC profile and mode.
+uint32_t INA219_get_conversion_time_us()
+{
+    uint32_t time = profile_conversion_times_us[_ina219->adc_profile];
+
+    // Mode bit 0 enables the shunt voltage and bit 1 the bus voltage conversion.
+    if ((_ina219->configuration & INA219_CONFIG_MODE_BOTH_TRIGGERED) == INA219_CONFIG_MODE_BOTH_TRIGGERED)
+    {
+        time <<= 1;
+    }
+
+    return time;
+}
+
+// Return 1 if the latest shunt voltage clipped at the full scale of the PGA range.
+__bit INA219_overflow()
+{
+    int16_t shunt      = _ina219->shunt_voltage_register;
+    int16_t full_scale = INA219_SHUNT_FULL_SCALE_PGA_1 << _ina219->pga_shift;
+    full_scale -= full_scale >> 6;
+
+    return shunt >= full_scale || shunt <= -full_scale;
+}
+
+// Set the trim of the selected shunt, see Calibration 9.
+// - The trim is per shunt resistor, set it again after INA219_switch_shunt().
+void INA219_set_trim(int16_t gain, int16_t offset)
+{
+    _ina219->trim_gain   = gain;
+    _ina219->trim_offset = offset;
+}
+
+// Return 1 if the last transaction of the selected device failed after all retries.
+__bit INA219_bus_error()
+{
+    return _ina219->bus_error;
+}
+
+uint16_t INA219_get_retries()
+{
+    return _ina219->retries;
+}
+
+uint16_t INA219_get_errors()
+{
+    return _ina219->errors;
 }
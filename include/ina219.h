@@ -18,6 +18,7 @@
 
 #pragma once
 
+#include <i2c.h>
 #include <stdint.h>
 
 // INA219 Registers
@@ -36,6 +37,7 @@
 #define INA219_CONFIG_PG_2_80mV             0x0800  // Gain /2 -  ±80mV
 #define INA219_CONFIG_PG_4_160mV            0x1000  // Gain /4 - ±160mV
 #define INA219_CONFIG_PG_8_320mV            0x1800  // Gain /8 - ±320mV
+#define INA219_CONFIG_PG_MASK               0x1800
 #define INA219_CONFIG_BADC_9BIT             0x0000  // 84uS
 #define INA219_CONFIG_BADC_10BIT            0x0080  // 148uS
 #define INA219_CONFIG_BADC_11BIT            0x0100  // 276uS
@@ -47,6 +49,7 @@
 #define INA219_CONFIG_BADC_AVG_32           0x0680  // 17020uS
 #define INA219_CONFIG_BADC_AVG_64           0x0700  // 34050uS
 #define INA219_CONFIG_BADC_AVG_128          0x0780  // 68100uS
+#define INA219_CONFIG_BADC_MASK             0x0780
 #define INA219_CONFIG_SADC_9BIT             0x0000  // 84uS
 #define INA219_CONFIG_SADC_10BIT            0x0008  // 148uS
 #define INA219_CONFIG_SADC_11BIT            0x0010  // 276uS
@@ -58,6 +61,7 @@
 #define INA219_CONFIG_SADC_AVG_32           0x0068  // 17020uS
 #define INA219_CONFIG_SADC_AVG_64           0x0070  // 34050uS
 #define INA219_CONFIG_SADC_AVG_128          0x0078  // 68100uS
+#define INA219_CONFIG_SADC_MASK             0x0078
 #define INA219_CONFIG_MODE_POWER_DOWN       0x00
 #define INA219_CONFIG_MODE_SHUNT_TRIGGERED  0x01
 #define INA219_CONFIG_MODE_BUS_TRIGGERED    0x02
@@ -66,15 +70,32 @@
 #define INA219_CONFIG_MODE_SHUNT_CONTINUOUS 0x05
 #define INA219_CONFIG_MODE_BUS_CONTINUOUS   0x06
 #define INA219_CONFIG_MODE_BOTH_CONTINUOUS  0x07
+#define INA219_CONFIG_MODE_MASK             0x07
 
 // Bus Voltage Register Flags
 #define INA219_BUS_VOLTAGE_CONVERSION_READY 0x02
 #define INA219_BUS_VOLTAGE_MATH_OVERFLOW    0x01
 
 // Configuration
-#define INA219_CONFIG_32V_320mV_16AVG_CONTINUOUS                                                                \
-    INA219_CONFIG_BRGN_32V | INA219_CONFIG_PG_8_320mV | INA219_CONFIG_BADC_AVG_16 | INA219_CONFIG_SADC_AVG_16 | \
-        INA219_CONFIG_MODE_BOTH_CONTINUOUS
+#define INA219_CONFIG_32V_320mV_16AVG_CONTINUOUS                                                                 \
+    (INA219_CONFIG_BRGN_32V | INA219_CONFIG_PG_8_320mV | INA219_CONFIG_BADC_AVG_16 | INA219_CONFIG_SADC_AVG_16 | \
+     INA219_CONFIG_MODE_BOTH_CONTINUOUS)
+
+// ADC Profiles
+//    The bus and shunt ADCs share the same resolution / averaging.
+//    A conversion cycle converts the bus voltage and then the shunt voltage, so
+//    it takes twice the channel conversion time, or once in shunt-only mode.
+//    Profile                 Channel Conversion Time    Resolution
+#define INA219_PROFILE_FAST    0  //     84 uS             9-bit
+#define INA219_PROFILE_12BIT   1  //    532 uS            12-bit
+#define INA219_PROFILE_AVG_4   2  //   2130 uS    4 samples averaging
+#define INA219_PROFILE_AVG_16  3  //   8510 uS   16 samples averaging, default
+#define INA219_PROFILE_PRECISE 4  //  68100 uS  128 samples averaging
+#define INA219_PROFILES        5
+//
+//    The Conversion Ready (CNVR) bit is set when a cycle completes, and cleared
+//    by reading the power register or writing the configuration register.
+//    The power register is read only to clear CNVR, its content is not used.
 
 // LSBs
 #define INA219_SHUNT_VOLTAGE_LSB_uV 10
@@ -92,61 +113,143 @@
 //    Choose 0.1 Ω to leave some buffer.
 //
 // 2. Calculate Current LSB
-//    The current register's range is [-2^15, 2^15 - 1]
-//    Minimal Current_LSB = 2 A / (2 ^ 15 - 1) = 0.000061037 ~ 61 uA
-//    Round up to 100 uA
+//    Current              = Shunt_Voltage / Rshunt
+//                         = Shunt_Register x Shunt_LSB / Rshunt
+//    Current_LSB          = Shunt_LSB / Rshunt = 10 uV / 0.1 Ω = 100 uA
 //
 #define INA219_CURRENT_LSB_uA_0 100  // 0.1 Ω shunt resistor
 #define INA219_CURRENT_LSB_uA_1 10   //   1 Ω shunt resistor
 #define INA219_CURRENT_LSB_uA_2 1    //  10 Ω shunt resistor
 //
-// 3. Calculate the Calibration Register
-//    Calibration_Register = 0.04096 / (Current_LSB x Rshunt) = 4096 = 0x1000
-//    To better understand Calibration Register:
-//    Current_Register     = Shunt_Register x Calibration_Register / 4096    (1) From Data Sheet
-//    Current              = Current_Register x Current_LSB                  (2)
-//    Current              = Shunt_Voltage / Rshunt                          (3)
-//    Shunt_Voltage        = Shunt_Register x Shunt_LSB                      (4)
-//    Current_Register     = Current / Current_LSB                           (2)+(3)+(4)
-//                         = Shunt_Voltage / (Rshunt x Current_LSB)
-//                            Shunt_Register x Shunt_LSB
-//                         = ----------------------------                    (5)
-//                               Current_LSB x Rshunt
-//    Calibration_Register = 4096 x Shunt_LSB / (Current_LSB x Rshunt)       (1)+(5)
-//                         = 4096 x 0.00001 / (Current_LSB x Rshunt)
-//                         = 0.04096 / (Current_LSB x Rshunt)
-//    The factor 4096 is too normalize Calibration_Register in the 12-bit ADC range.
-//
-#define INA219_CALIBRATION 0x1000
-//
-// 4. Calculate the Power Register LSB
-//    Power_Register = (Bus_Voltage_Register x Current_Register) / 5000      (1) From Data Sheet
-//    Power          = Power_Register x Power_LSB                            (2)
-//    Power          = Bus_Voltage x Current                                 (3)
-//    Power_LSB      = Power / Power_Register                                (1)+(2)+(3)
-//                                Bus_Voltage x Current
-//                   = --------------------------------------------------
-//                      (Bus_Voltage_Register x Current_Register) / 5000
-//                   = 5000 x Bus_LSB x Current_LSB
-//                   = 5000 x 0.004 x Current_LSB
-//    Power_LSB      = 20 x Current_LSB
-//
-#define INA219_POWER_LSB_uW_0 2000  // 20 x INA219_CURRENT_LSB_uA_0
-#define INA219_POWER_LSB_uW_1 200   // 20 x INA219_CURRENT_LSB_uA_1
-#define INA219_POWER_LSB_uW_2 20    // 20 x INA219_CURRENT_LSB_uA_2
+// 3. Calibration Register
+//    The calibration register only scales the on-chip current and power registers.
+//    Current and power are derived in firmware from the shunt and bus voltage
+//    registers instead, so the calibration register is left unprogrammed.
+//    A sample reads 3 registers, each with a pointer write: the bus voltage for
+//    CNVR, the shunt voltage, and the power register only to clear CNVR.
+//
+// 4. Calculate Power
+//    Power          = Bus_Voltage x Current
+//                   = (Bus_Register x Bus_LSB) x (Shunt_Register x Current_LSB)
+//    Power_uW       = Bus_Register x Shunt_Register x 4 x Current_LSB_uA / 1000
+//                   = Bus_Register x Shunt_Register x 2 / (500 / Current_LSB_uA)
+//    Bus_Register x Shunt_Register is at most 8191 x 32767 = 268,394,497, so the
+//    product x 2 still fits in int32_t, also with the trimmed register (see 9.)
+//    which is at most 1.0625 x the raw register.
+//
+#define INA219_POWER_DIVISOR_0 5    // 500 / INA219_CURRENT_LSB_uA_0
+#define INA219_POWER_DIVISOR_1 50   // 500 / INA219_CURRENT_LSB_uA_1
+#define INA219_POWER_DIVISOR_2 500  // 500 / INA219_CURRENT_LSB_uA_2
 //
 // 5. Max Current in This Configuration
 //    Current_1 = Max_Shunt_Voltage / Rshunt = 320 mV / 0.1 Ω = 3.2 A
-//    Current_2 = Max_Current_Register x Current_LSB = (2^15 - 1) x 100 uA = 3.2767 A
 //    Max Current = 3.2A
 //
 // 6. Resistor Rating
 //    3.2 A x 3.2 A x 0.1 Ω = 1.024 W
 //
+// 7. Per-shunt PGA Gain
+//    The shunt voltage register LSB is 10 uV for every PGA gain, but the 12-bit ADC
+//    spans the selected range, so the effective resolution is 10 uV x PGA divider.
+//    Shunt 1 and 2 see at most 100 mV before switching to a smaller shunt, /4 covers
+//    it with 2x the resolution of /8. /2 (±80 mV) would clip below the switch point.
+//    Shunt   PGA    Range     Max Current   Effective Resolution
+//      0      /8   ±320 mV       3.2 A           800 uA
+//      1      /4   ±160 mV       160 mA           40 uA
+//      2      /4   ±160 mV        16 mA            4 uA
+//
+#define INA219_PGA_0 INA219_CONFIG_PG_8_320mV
+#define INA219_PGA_1 INA219_CONFIG_PG_4_160mV
+#define INA219_PGA_2 INA219_CONFIG_PG_4_160mV
+#define INA219_PGA_SHIFT_0 3  // log2(PGA divider)
+#define INA219_PGA_SHIFT_1 2
+#define INA219_PGA_SHIFT_2 2
+//
+// 8. Overflow
+//    The math overflow flag (OVF) only covers the on-chip current and power registers,
+//    which are not calibrated, so it is never set. A reading out of the PGA range is
+//    detected by the shunt voltage register clipping at the full scale instead.
+//    Full_Scale = 4000 x PGA divider (±40 mV at /1), clipped within 1/64 of it.
+//
+#define INA219_SHUNT_FULL_SCALE_PGA_1 4000
+//
+// 9. Trim
+//    The current LSBs assume ideal shunt resistors, the resistor tolerance and the
+//    MOSFET and trace resistance add a gain error, the ADC adds an offset. Both are
+//    trimmed per device in fixed-point on the shunt voltage register,
+//    Trimmed_Register = (Shunt_Register - Offset) x (1 + Gain / 32768)
+//    - Offset in shunt voltage register LSBs.
+//    - Gain error in Q15, limited to ±INA219_TRIM_GAIN_MAX (±6.25%), so
+//      |Register x Gain| < 2^15 x 2^11 and the product fits in int32_t.
+//    Current, power and shunt voltage are derived from the trimmed register, the
+//    overflow detection uses the raw register.
+//
+// 10. Scaling Without 32-bit Multiplies
+//    SDCC turns an int32_t multiply into a _mullong library call. The trimmed register
+//    is kept as a 16-bit magnitude and a sign instead, and every LSB or gain fits in
+//    8 bits, so each scaling is a 16 x 8 bit multiply of two 8 x 8 bit MUL AB, see
+//    INA219_mul16x8(). The sign is applied to the 32-bit result at last.
+//    Estimated cycles per sample on the CH552 1T core, from the instruction sequence,
+//    with no trim (a gain trim adds 2 multiplies, about 60 cycles):
+//    Shunt   Current_LSB   Shunt Voltage          Current
+//      0       100 uA      16x8,   ~40 cycles     16x8, ~40 cycles
+//      1        10 uA      16x8,   ~40 cycles     16x8, ~40 cycles
+//      2         1 uA      16x8,   ~40 cycles     no multiply, ~15 cycles
+//    Power is a 16 x 16 bit product of 4 MUL AB per sample, see
+//    INA219_get_power_product(). The division by the power divisor is left to the
+//    average of the products over a display interval.
+//
+#define INA219_TRIM_GAIN_ONE 32768
+#define INA219_TRIM_GAIN_MAX 2048
+//
+
+#define INA219_ADDR ((uint8_t)0x45 << 1)  // The on-board INA219
 
-#define INA219_ADDR ((uint8_t)0x45 << 1)
+// I2C error handling
+// - A transaction with a NAK is retried up to INA219_RETRIES times after a bus recovery.
+// - The register pointer is unknown after a NAK, the retry writes it again.
+// - After the last retry the transaction fails, see INA219_bus_error().
+#define INA219_RETRIES          2
+#define INA219_REGISTER_UNKNOWN 0xFF
 
-void INA219_init();
+// I2C timing profile of a device initialized by INA219_init(), see I2C_TIMING_* in i2c.h
+// - Fast mode by default, the bus relies on the pull-up resistors of the OLED module.
+// - The INA219 supports high-speed mode up to 2.56MHz, entered with the master code at
+//   the start of every transaction. HS holds SCL high for about 2 cycles, it needs
+//   strong pull-ups with short rise times, enable it only after checking the bus on
+//   the hardware, e.g. with INA219_set_timing(I2C_TIMING_HS).
+#define INA219_I2C_TIMING I2C_TIMING_FAST
+
+// Device context, one per INA219 on the bus
+// - Select a device with INA219_select(), the following calls operate on it.
+typedef struct INA219_device
+{
+    uint8_t  addr;                    // I2C write address
+    uint8_t  register_pointer;        // The register the INA219 points to
+    uint8_t  i2c_timing;              // I2C timing profile, see I2C_TIMING_*
+    uint16_t configuration;           // Configuration register
+    uint8_t  shunt;                   // Shunt resistor, selects the LSBs and PGA gain
+    uint8_t  adc_profile;             // See INA219_PROFILE_*
+    uint8_t  pga_shift;               // log2(PGA divider)
+    uint8_t  current_uA_LSB;          // Current LSB of the shunt
+    uint16_t power_divisor;           // Power divisor of the shunt
+    uint16_t bus_voltage_register;    // The latest bus voltage register, including the CNVR and OVF flags
+    int16_t  shunt_voltage_register;  // The latest shunt voltage register
+    uint16_t trimmed_shunt_magnitude; // |The latest shunt voltage register with the trim applied|
+    uint8_t  trimmed_shunt_negative;  // The sign of the trimmed shunt voltage register
+    int16_t  trim_gain;               // Gain error in Q15, see Calibration 9.
+    int16_t  trim_offset;             // Offset in shunt voltage register LSBs
+    uint16_t retries;                 // Transactions retried after a NAK
+    uint16_t errors;                  // Transactions failed after INA219_RETRIES retries
+    uint8_t  bus_error;               // The last transaction failed
+} INA219_device;
+
+void INA219_select(__xdata INA219_device* device);
+void INA219_init(uint8_t addr);
+void INA219_set_timing(uint8_t timing);
+void INA219_set_mode(uint8_t mode);
+void INA219_select_register(uint8_t reg);
+void INA219_start_shunt_stream();
 
 inline uint16_t INA219_get_raw_shunt_voltage();
 inline uint16_t INA219_get_raw_bus_voltage();
@@ -155,7 +258,20 @@ inline uint16_t INA219_get_raw_current();
 
 int32_t INA219_get_shunt_voltage_uV();
 int32_t INA219_get_bus_voltage_mV();
-int32_t INA219_get_power_uW();
+uint32_t INA219_get_power_product();
+uint16_t INA219_get_power_divisor(uint8_t shunt);
 int32_t INA219_get_current_uA();
 
-void INA219_switch_shunt(uint8_t shunt);
+__bit   INA219_conversion_ready();
+void    INA219_clear_conversion_ready();
+int32_t INA219_get_latched_bus_voltage_mV();
+
+void     INA219_switch_shunt(uint8_t shunt);
+void     INA219_set_profile(uint8_t profile);
+uint32_t INA219_get_conversion_time_us();
+__bit    INA219_overflow();
+void     INA219_set_trim(int16_t gain, int16_t offset);
+
+__bit    INA219_bus_error();
+uint16_t INA219_get_retries();
+uint16_t INA219_get_errors();
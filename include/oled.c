@@ -4,6 +4,11 @@
 // Required Libraries
 // - I2C library from https://github.com/wagiminator/CH552-USB-OLED
 //
+// Interfaces, selected at build time, see OLED_INTERFACE in the Makefile
+// - I2C (default), queued on the bus shared with the INA219, I2C_init() is called first.
+// - SPI (OLED_SPI), 4-wire SPI on the hardware SPI0, SCK P1.7, MOSI P1.5, CS P1.4,
+//   DC P3.5. The I2C bus moves to P1.3 (SDA) and P1.2 (SCL), the buzzer to P1.0.
+//
 // References
 // - https://github.com/wagiminator/CH552-USB-OLED
 // - https://github.com/datacute/Tiny4kOLED
@@ -15,13 +20,52 @@
 
 #include "oled.h"
 
+#ifdef OLED_SPI
+#include "ch554.h"
+#include "gpio.h"
+#else
 #include "i2c.h"
+#endif
+
+#ifdef OLED_SPI
+// SPI pins, SCK (D0) on P1.7 and MOSI (D1) on P1.5 are fixed by the hardware SPI0.
+// RES is left to the reset circuit of the module.
+#define OLED_PIN_CS P14  // chip select, active LOW
+#define OLED_PIN_DC P35  // LOW: command, HIGH: data
+
+// SPI0 clock divisor, the SSD1306 is specified for up to 10 MHz, SPI0 runs at Fsys / 2 at most.
+#define OLED_SPI_DIV_MIN ((FREQ_SYS + 9999999) / 10000000)
+#define OLED_SPI_DIV     (OLED_SPI_DIV_MIN < 2 ? 2 : OLED_SPI_DIV_MIN)
 
+#define OLED_CHUNK_BYTES 32  // OLED_clear() only, transactions are not split
+
+// Bytes of a new address window, unchanged glyphs up to this size are resent instead.
+#define OLED_READDRESS_BYTES 6
+#else
 // OLED definitions
 #define OLED_ADDR      0x78  // OLED write address (0x3C << 1)
 #define OLED_CMD_MODE  0x00  // set command mode
 #define OLED_DATA_MODE 0x40  // set data mode
 
+// I2C timing profile, the SSD1306 is specified for 400kHz, many modules run at 1MHz
+// with I2C_TIMING_FAST_PLUS.
+#define OLED_I2C_TIMING I2C_TIMING_FAST
+
+// Data transactions are split into chunks of whole glyphs of at most OLED_CHUNK_BYTES.
+// - A blocking transaction of another device waits for the chunk on the bus only,
+//   at most 2 + 32 bytes and the stop, 35 queue ticks, about 1.75 ms.
+// - The SSD1306 keeps its address pointer between transactions, a chunk continues
+//   where the previous one stopped.
+// - Before a transaction, the yield function runs and the queue is drained until the
+//   next chunk fits, see OLED_setYield().
+#define OLED_CHUNK_BYTES   32
+#define OLED_CHUNK_ENTRIES (OLED_CHUNK_BYTES + 3)  // start, data mode, data and stop
+
+// Bytes of a new address window, command and data transaction, unchanged glyphs up
+// to this size are resent instead.
+#define OLED_READDRESS_BYTES 12
+#endif
+
 // OLED commands
 #define OLED_COLUMN_LOW         0x00  // set lower 4 bits of start column (0x00 - 0x0F)
 #define OLED_COLUMN_HIGH        0x10  // set higher 4 bits of start column (0x10 - 0x1F)
@@ -60,63 +104,330 @@ __code uint8_t OLED_INIT_CMD[] = {
     OLED_DISPLAY_ON                            // display on
 };
 
-__data uint8_t _page   = 0;  // OLED memory pages, from 0 to 7.
-__data uint8_t _column = 0;  // OLED memory columns, from 0 to 127.
-OLED_font*     _font;        // Default font
-__bit          _color = 1;
+__data uint8_t  _page   = 0;  // OLED memory pages, from 0 to 7.
+__data uint8_t  _column = 0;  // OLED memory columns, from 0 to 127.
+OLED_font*      _font;        // Default font
+__bit           _color  = 1;
 
-// OLED init function
-void OLED_init(void)
+// Shadow of the character cells on screen, only changed glyphs are sent.
+// - A cell is a page and a column / 4, glyphs are at least 5 columns apart.
+// - A cell holds the character, bit 7 is set for inverted color, 8x16 glyphs take
+//   2 cells. 0 is a cell that is unknown, e.g. after a NAK.
+// - The font and the column within the cell are not recorded, a layout draws the
+//   same font at the same columns until OLED_clear().
+#define OLED_CELLS_PER_PAGE 32
+#define OLED_CELL_UNKNOWN   0
+#define OLED_CELL_INVERT    0x80
+__xdata uint8_t _cells[8 * OLED_CELLS_PER_PAGE];
+
+// Address window of the display and its pointer, in vertical addressing mode a glyph
+// leaves the pointer at the top page of the next column.
+#define OLED_WINDOW_UNKNOWN 0xFF
+__data uint8_t _window_start = OLED_WINDOW_UNKNOWN;  // First page of the window
+__data uint8_t _window_end   = 0;                    // Last page of the window
+__data uint8_t _pointer      = 0;                    // Column of the next data byte
+__bit          _sending      = 0;                    // A data transaction is open at the cursor
+__bit          _row          = 0;                    // Between OLED_startRow() and OLED_endRow()
+#ifdef OLED_SPI
+// The display has the hardware SPI0 to itself, a byte is shifted out in 8 x OLED_SPI_DIV
+// cycles while the CPU waits, e.g. about 2us at 12MHz, compared to about 30us for a
+// queued I2C byte.
+
+// Transmit one byte, wait until it is shifted out
+void OLED_send(uint8_t data)
+{
+    SPI0_DATA = data;
+    while (!S0_FREE)
+        ;
+}
+
+void OLED_sendBuf(const uint8_t* buf, uint8_t len)
+{
+    do
+    {
+        OLED_send(*buf++);
+    } while (--len);
+}
+
+void OLED_sendRepeat(uint8_t data, uint8_t count)
+{
+    do
+    {
+        OLED_send(data);
+    } while (--count);
+}
+
+// Start a command transaction
+void OLED_startCommand(void)
+{
+    PIN_low(OLED_PIN_DC);
+    PIN_low(OLED_PIN_CS);
+}
+
+// Start a data transaction
+void OLED_startData(void)
+{
+    PIN_high(OLED_PIN_DC);
+    PIN_low(OLED_PIN_CS);
+}
+
+// Stop transmission, the last byte is shifted out by OLED_send().
+void OLED_stop(void)
+{
+    PIN_high(OLED_PIN_CS);
+}
+
+// Transactions are not split, nothing else is on the SPI bus.
+#define OLED_reserve(len)
+
+// The SPI display does not hold the I2C bus, there is nothing to yield to.
+void OLED_setYield(void (*yield)(void))
+{
+    yield;
+}
+
+// SPI has no acknowledge.
+uint16_t OLED_get_errors(void)
+{
+    return 0;
+}
+
+void OLED_init_interface(void)
+{
+    PIN_output(OLED_PIN_CS);
+    PIN_high(OLED_PIN_CS);
+    PIN_output(OLED_PIN_DC);
+    PIN_output(P17);                          // SCK
+    PIN_output(P15);                          // MOSI
+    SPI0_SETUP = 0;                           // master, MSB first
+    SPI0_CK_SE = OLED_SPI_DIV;
+    SPI0_CTRL  = bS0_SCK_OE | bS0_MOSI_OE;    // mode 0, SCK LOW when idle
+}
+#else
+__data uint8_t  _chunk  = 0;  // Data bytes in the current transaction
+__data uint16_t _errors = 0;  // I2C_queue_errors() seen by the cell shadow
+void (*_yield)(void)    = 0;  // Runs between transactions, see OLED_setYield()
+
+// The transactions are queued and sent in the background, see I2C_post_start().
+
+#define OLED_send(data)              I2C_post(data)
+#define OLED_sendBuf(buf, len)       I2C_post_buf(buf, len)
+#define OLED_sendRepeat(data, count) I2C_post_repeat(data, count)
+
+// Start transmission to OLED with its timing profile
+// - The previous transaction is queued completely, the yield function may run
+//   blocking transactions of other devices.
+void OLED_start(void)
 {
-    I2C_init();                // initialize I2C first
-    I2C_start(OLED_ADDR);      // start transmission to OLED
-    I2C_write(OLED_CMD_MODE);  // set command mode
-    uint8_t size = sizeof(OLED_INIT_CMD);
-    for (uint8_t i = 0; i < size; i++)
+    if (_yield)
     {
-        I2C_write(OLED_INIT_CMD[i]);  // send the command bytes
+        do
+        {
+            _yield();
+        } while (I2C_queue_free() < OLED_CHUNK_ENTRIES);
     }
-    I2C_stop();                       // stop transmission
+    I2C_post_start(OLED_ADDR, OLED_I2C_TIMING);
+}
+
+// Stop transmission, a NAK is counted and the bus recovered, the next refresh redraws.
+void OLED_stop(void)
+{
+    I2C_post_stop();
+}
+
+// Start a command transaction
+void OLED_startCommand(void)
+{
+    OLED_start();
+    I2C_post(OLED_CMD_MODE);
+}
+
+// Start a data transaction
+void OLED_startData(void)
+{
+    OLED_start();
+    I2C_post(OLED_DATA_MODE);
+    _chunk = 0;
+}
+
+// Make room for len data bytes in the current chunk, or continue in a new chunk
+void OLED_reserve(uint8_t len)
+{
+    if (_chunk + len > OLED_CHUNK_BYTES)
+    {
+        OLED_stop();
+        OLED_startData();
+    }
+    _chunk += len;
+}
+
+// Set the function that runs between transactions, e.g. to read a pending sample
+// of a sensor on the same bus, 0 to disable.
+void OLED_setYield(void (*yield)(void))
+{
+    _yield = yield;
+}
+
+// The OLED is the only device with queued transactions.
+uint16_t OLED_get_errors(void)
+{
+    return I2C_queue_errors();
+}
+
+// The I2C bus is initialized by the caller, it is shared with other devices.
+#define OLED_init_interface()
+#endif
+
+// OLED init function
+void OLED_init(void)
+{
+    OLED_init_interface();
+    OLED_startCommand();                                  // start transmission in command mode
+    OLED_sendBuf(OLED_INIT_CMD, sizeof(OLED_INIT_CMD));   // send the command bytes
+    OLED_stop();                                          // stop transmission
 }
 
 // Set memory address range
 void OLED_setMemoryAddress(uint8_t start_page, uint8_t end_page, uint8_t start_column, uint8_t end_column)
 {
-    _page   = start_page;
-    _column = start_column;
-    I2C_start(OLED_ADDR);              // start transmission to OLED
-    I2C_write(OLED_CMD_MODE);          // set command mode
-    I2C_write(OLED_PAGE_ADDRESSES);    // set page addresses
-    I2C_write(start_page);             // set start page
-    I2C_write(end_page);               // set end page
-    I2C_write(OLED_COLUMN_ADDRESSES);  // set page addresses
-    I2C_write(start_column);           // set start page
-    I2C_write(end_column);             // set end page
-    I2C_stop();                        // stop transmission
+    __xdata uint8_t cmd[6];
+
+    _page         = start_page;
+    _column       = start_column;
+    _window_start = start_page;
+    _window_end   = end_page;
+    _pointer      = start_column;
+
+    cmd[0] = OLED_PAGE_ADDRESSES;    // set page addresses
+    cmd[1] = start_page;             // set start page
+    cmd[2] = end_page;               // set end page
+    cmd[3] = OLED_COLUMN_ADDRESSES;  // set column addresses
+    cmd[4] = start_column;           // set start column
+    cmd[5] = end_column;             // set end column
+
+    OLED_startCommand();             // start transmission in command mode
+    OLED_sendBuf(cmd, sizeof(cmd));
+    OLED_stop();                     // stop transmission
+}
+
+void OLED_fillCells(uint8_t cell)
+{
+    __xdata uint8_t* p = _cells;
+
+    do
+    {
+        *p++ = cell;
+    } while (p != _cells + sizeof(_cells));
+}
+
+// Forget the screen content, everything is sent again.
+void OLED_invalidate(void)
+{
+    OLED_fillCells(OLED_CELL_UNKNOWN);
+}
+
+// Record c at the cursor, return 1 if it differs from the screen.
+__bit OLED_updateCells(char c)
+{
+    __xdata uint8_t* cell    = &_cells[(_page * OLED_CELLS_PER_PAGE) | ((_column >> 2) & (OLED_CELLS_PER_PAGE - 1))];
+    uint8_t          code    = _color ? c : c | OLED_CELL_INVERT;
+    __bit            changed = 0;
+
+#ifndef OLED_SPI
+    if (I2C_queue_errors() != _errors)  // A queued transaction failed, redraw everything
+    {
+        _errors = I2C_queue_errors();
+        OLED_invalidate();
+        _window_start = OLED_WINDOW_UNKNOWN;
+    }
+#endif
+
+    for (uint8_t i = _font->height; i; i--, cell += OLED_CELLS_PER_PAGE)
+    {
+        if (*cell != code)
+        {
+            *cell   = code;
+            changed = 1;
+        }
+    }
+
+    return changed;
+}
+
+// Open a data transaction at the cursor, the address window is sent only if the
+// display pointer is somewhere else.
+void OLED_open(void)
+{
+    if (_sending)
+    {
+        return;
+    }
+
+    if (_window_start != _page || _window_end != _page + _font->height - 1 || _pointer != _column)
+    {
+        OLED_setMemoryAddress(_page, _page + _font->height - 1, _column, 127);
+    }
+    OLED_startData();  // start transmission to OLED in data mode
+    _sending = 1;
+}
+
+// Close the data transaction, the display pointer is at the cursor.
+void OLED_close(void)
+{
+    if (!_sending)
+    {
+        return;
+    }
+
+    OLED_stop();  // stop transmission
+    _sending = 0;
+    _pointer = _column;
+    if (_column > 127)  // The pointer wrapped to the start of the window
+    {
+        _window_start = OLED_WINDOW_UNKNOWN;
+    }
 }
 
 // Clear screen
 void OLED_clear(void)
 {
+    OLED_close();
     OLED_setMemoryAddress(0, 7, 0, 127);
 
-    I2C_start(OLED_ADDR);       // start transmission to OLED
-    I2C_write(OLED_DATA_MODE);  // set data mode
-    for (uint8_t page = 8; page; page--)
+    OLED_startData();  // start transmission to OLED in data mode
+    for (uint8_t i = 1024 / OLED_CHUNK_BYTES; i; i--)
     {
-        for (uint8_t column = 128; column; column--)
-        {
-            I2C_write(0x00);
-        }
+        OLED_reserve(OLED_CHUNK_BYTES);
+        OLED_sendRepeat(0x00, OLED_CHUNK_BYTES);
     }
-    I2C_stop();  // stop transmission
+    OLED_stop();  // stop transmission
 
-    _page   = 0;
-    _column = 0;
+    OLED_fillCells(' ');  // a space is blank in every font
+    _window_start = OLED_WINDOW_UNKNOWN;
+    _page         = 0;
+    _column       = 0;
+}
+
+// Draw a column of raw bytes, one per page from start_page, the cell shadow is not updated.
+void OLED_plotColumn(uint8_t column, uint8_t start_page, const uint8_t* data, uint8_t pages)
+{
+    OLED_close();
+    OLED_setMemoryAddress(start_page, start_page + pages - 1, column, column);
+
+    OLED_startData();  // start transmission to OLED in data mode
+    OLED_reserve(pages);
+    OLED_sendBuf(data, pages);
+    OLED_stop();       // stop transmission
+
+    _window_start = OLED_WINDOW_UNKNOWN;  // The pointer wrapped to the start of the window
 }
 
 void OLED_setFont(OLED_font* font)
 {
+    if (font != _font)
+    {
+        OLED_close();  // The address window has the height of the font
+    }
     _font = font;
 }
 
@@ -127,54 +438,193 @@ void OLED_setColor(__bit color)
 
 void OLED_setCursor(uint8_t page, uint8_t column)
 {
+    if (page != _page || column != _column)
+    {
+        OLED_close();
+    }
     _page   = page;
     _column = column;
 }
 
-// Plot a character
-void OLED_plotChar(char c)
+// Plot a character with the generic renderer
+// - A glyph is width x height bytes in a row, inverted by an XOR mask.
+// - A glyph and its spacing are never split between chunks.
+void OLED_plotGlyph(char c)
 {
-    uint8_t i, j, byte;
+    uint8_t i;
+    uint8_t mask = _color ? 0x00 : 0xFF;
+    uint8_t size = _font->width * _font->height;
 
-    const uint8_t* data = &_font->data[(uint16_t)(c - _font->first) * _font->width * _font->height];
+    __code const uint8_t* data = &_font->data[(uint16_t)(c - _font->first) * size];
 
-    for (i = _font->width; i; i--)
+    OLED_reserve(size + _font->spacing * _font->height);
+
+    for (i = size; i; i--)
     {
-        for (j = _font->height; j; j--)
-        {
-            byte = *data++;
-            I2C_write(_color ? byte : ~byte);
-        }
-        _column++;
+        OLED_send(*data++ ^ mask);
     }
-    for (i = _font->spacing; i; i--)
+    _column += _font->width;
+
+    if (_font->spacing)
     {
-        for (j = _font->height; j; j--)
+        OLED_sendRepeat(mask, _font->spacing * _font->height);
+        _column += _font->spacing;
+    }
+}
+
+// Specialized renderers, the glyph size, stride and spacing are constants.
+// - The glyph offset is a constant multiply, (c - 32) x 5 is a single MUL AB, x 16 a shift.
+// - One XOR mask for inverse video, no branch on the color per byte.
+// - The font descriptor is read once for the data pointer instead of 6 generic pointer
+//   reads, see OLED_plotGlyph().
+// Estimated cycles per glyph on the CH552, counted from the instruction sequences, not
+// measured. Queuing a byte (I2C_post_op()) takes about 45 cycles, an SPI byte at
+// Fsys / 2 about 30 cycles.
+//   Font   bytes   generic I2C   specialized I2C   specialized SPI
+//   5x8      6        ~700           ~480              ~360
+//   8x16    16       ~1250          ~1020              ~730
+#define OLED_RENDERER(name, WIDTH, HEIGHT, SPACING, FIRST)                  \
+    void name(char c)                                                       \
+    {                                                                       \
+        uint8_t               i;                                            \
+        uint8_t               mask = _color ? 0x00 : 0xFF;                  \
+        __code const uint8_t* data = _font->data;                           \
+                                                                            \
+        data += (uint16_t)(uint8_t)(c - (FIRST)) * ((WIDTH) * (HEIGHT));    \
+        OLED_reserve(((WIDTH) + (SPACING)) * (HEIGHT));                     \
+        for (i = (WIDTH) * (HEIGHT); i; i--)                                \
+        {                                                                   \
+            OLED_send(*data++ ^ mask);                                      \
+        }                                                                   \
+        OLED_SPACING_##SPACING(mask, HEIGHT)                                \
+        _column += (WIDTH) + (SPACING);                                     \
+    }
+
+// The spacing columns of a renderer, selected by pasting the spacing of the font,
+// no condition on a constant for SDCC to warn about under --Werror
+#define OLED_SPACING_0(mask, HEIGHT)
+#define OLED_SPACING_1(mask, HEIGHT) OLED_sendRepeat(mask, (HEIGHT));
+
+OLED_RENDERER(OLED_plot5x8, 5, 1, 1, 32)
+OLED_RENDERER(OLED_plot8x16, 8, 2, 0, 32)
+
+// Renderer of the column-RLE compressed fonts, e.g. font_12x24.h
+// - The data starts with the 16-bit offset of each glyph stream.
+// - Runs of 0x00 and 0xFF go out through OLED_sendRepeat(), literals byte by byte.
+// - A glyph may be split between chunks at a token, the spacing is not supported.
+void OLED_plotRLE(char c)
+{
+    __code const uint8_t* data  = _font->data;
+    uint8_t               mask  = _color ? 0x00 : 0xFF;
+    uint8_t               size  = _font->width * _font->height;
+    __code const uint8_t* index = data + (uint8_t)(c - _font->first) * 2;
+    uint8_t               token, count;
+
+    data += index[0] | (uint16_t)index[1] << 8;
+    _column += _font->width;
+
+    do
+    {
+        token = *data++;
+        count = token & 0x3F;
+        if (token & 0x80)
         {
-            I2C_write(_color ? 0x00 : 0xff);
+            OLED_reserve(count);
+            OLED_sendRepeat(((token & 0x40) ? 0xFF : 0x00) ^ mask, count);
         }
-        _column++;
+        else
+        {
+            count = token;
+            OLED_reserve(count);
+            for (uint8_t i = count; i; i--)
+            {
+                OLED_send(*data++ ^ mask);
+            }
+        }
+        size -= count;
+    } while (size);
+}
+
+// Plot a character with the renderer of the font
+void OLED_plotChar(char c)
+{
+    if (_font->plot)
+    {
+        _font->plot(c);
+    }
+    else
+    {
+        OLED_plotGlyph(c);
+    }
+}
+
+// Plot a character at the cursor if it changed
+// - An unchanged glyph is resent if that is cheaper than a new address window.
+void OLED_putChar(char c)
+{
+    uint8_t advance = _font->width + _font->spacing;
+
+    if (OLED_updateCells(c) || (_sending && advance * _font->height <= OLED_READDRESS_BYTES))
+    {
+        OLED_open();
+        OLED_plotChar(c);
+    }
+    else
+    {
+        OLED_close();
+        _column += advance;
     }
 }
 
-// Print a single character
+// Print a single character, it is sent only if it changed.
 void OLED_write(char c)
 {
-    OLED_setMemoryAddress(_page, _page + _font->height - 1, _column, 127);
-    I2C_start(OLED_ADDR);       // start transmission to OLED
-    I2C_write(OLED_DATA_MODE);  // set data mode
-    OLED_plotChar(c);
-    I2C_stop();                 // stop transmission
+    OLED_putChar(c);
+    if (!_row)
+    {
+        OLED_close();
+    }
 }
 
+// Print a string, every run of changed characters is sent in one data transaction.
 void OLED_print(const char* str)
 {
-    OLED_setMemoryAddress(_page, _page + _font->height - 1, _column, 127);
-    I2C_start(OLED_ADDR);       // start transmission to OLED
-    I2C_write(OLED_DATA_MODE);  // set data mode
     while (*str)
     {
-        OLED_plotChar(*str++);
+        OLED_putChar(*str++);
     }
-    I2C_stop();  // stop transmission
+    if (!_row)
+    {
+        OLED_close();
+    }
+}
+
+// Rows, consecutive OLED_write(), OLED_print() and OLED_skipTo() on one page share
+// a data transaction, e.g. a reading, its unit prefix and label.
+void OLED_startRow(void)
+{
+    _row = 1;
+}
+
+// Move the cursor to column of the row, the gap is sent blank if that is cheaper
+// than a new address window.
+void OLED_skipTo(uint8_t column)
+{
+    uint8_t size = (column - _column) * _font->height;
+
+    if (_sending && column > _column && size <= OLED_READDRESS_BYTES)
+    {
+        OLED_reserve(size);
+        OLED_sendRepeat(_color ? 0x00 : 0xff, size);
+        _column = column;
+        return;
+    }
+    OLED_close();
+    _column = column;
+}
+
+void OLED_endRow(void)
+{
+    _row = 0;
+    OLED_close();
 }
@@ -23,8 +23,16 @@
 
 void OLED_init(void);
 void OLED_clear(void);
+void OLED_invalidate(void);
 void OLED_setFont(OLED_font* font);
 void OLED_setColor(__bit color);
 void OLED_setCursor(uint8_t page, uint8_t column);
 void OLED_write(char c);
 void OLED_print(const char* str);
+void OLED_startRow(void);
+void OLED_skipTo(uint8_t column);
+void OLED_endRow(void);
+void OLED_setYield(void (*yield)(void));
+void OLED_plotColumn(uint8_t column, uint8_t start_page, const uint8_t* data, uint8_t pages);
+
+uint16_t OLED_get_errors(void);
@@ -6,34 +6,41 @@
 #define disable_interrupt() (EA = 0)
 #define enable_interrupt()  (EA = 1)
 
-inline void mcu_config(void)
-{
-    SAFE_MOD = 0x55;
-    SAFE_MOD = 0xAA;
-    //     CLOCK_CFG |= bOSC_EN_XT;                          // Enable external crystal
-    //     CLOCK_CFG & = ~ bOSC_EN_INT;                      // Turn off the internal crystal
-
+// System clock selection of FREQ_SYS
 #if FREQ_SYS == 32000000
-    CLOCK_CFG = CLOCK_CFG & ~MASK_SYS_CK_SEL | 0x07;  // 32MHz
+#define MCU_CLOCK_SEL 0x07  // 32MHz
 #elif FREQ_SYS == 24000000
-    CLOCK_CFG = CLOCK_CFG & ~MASK_SYS_CK_SEL | 0x06;  // 24MHz
+#define MCU_CLOCK_SEL 0x06  // 24MHz
 #elif FREQ_SYS == 16000000
-    CLOCK_CFG = CLOCK_CFG & ~MASK_SYS_CK_SEL | 0x05;  // 16MHz
+#define MCU_CLOCK_SEL 0x05  // 16MHz
 #elif FREQ_SYS == 12000000
-    CLOCK_CFG = CLOCK_CFG & ~MASK_SYS_CK_SEL | 0x04;  // 12MHz
+#define MCU_CLOCK_SEL 0x04  // 12MHz
 #elif FREQ_SYS == 6000000
-    CLOCK_CFG = CLOCK_CFG & ~MASK_SYS_CK_SEL | 0x03;  // 6MHz
+#define MCU_CLOCK_SEL 0x03  // 6MHz
 #elif FREQ_SYS == 3000000
-    CLOCK_CFG = CLOCK_CFG & ~MASK_SYS_CK_SEL | 0x02;  // 3MHz
+#define MCU_CLOCK_SEL 0x02  // 3MHz
 #elif FREQ_SYS == 750000
-    CLOCK_CFG = CLOCK_CFG & ~MASK_SYS_CK_SEL | 0x01;  // 750KHz
+#define MCU_CLOCK_SEL 0x01  // 750KHz
 #elif FREQ_SYS == 187500
-    CLOCK_CFG = CLOCK_CFG & ~MASK_SYS_CK_SEL | 0x00;  // 187.5MHz
+#define MCU_CLOCK_SEL 0x00  // 187.5KHz
 #else
 #warning FREQ_SYS invalid or not set
 #endif
 
-    SAFE_MOD = 0x00;
+// Switch the system clock, see MCU_CLOCK_SEL
+inline void mcu_set_clock(uint8_t clock_sel)
+{
+    SAFE_MOD  = 0x55;
+    SAFE_MOD  = 0xAA;
+    CLOCK_CFG = CLOCK_CFG & ~MASK_SYS_CK_SEL | clock_sel;
+    SAFE_MOD  = 0x00;
+}
+
+inline void mcu_config(void)
+{
+    //     CLOCK_CFG |= bOSC_EN_XT;                          // Enable external crystal
+    //     CLOCK_CFG & = ~ bOSC_EN_INT;                      // Turn off the internal crystal
+    mcu_set_clock(MCU_CLOCK_SEL);
 }
 
 inline void disable_LDO(void)
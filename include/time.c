@@ -1,13 +1,35 @@
 #include "ch554.h"
 
+#include <system.h>
 #include <time.h>
 
+// Timer0 ticks per millisecond at Fsys/12, and the reload value, see timer0_interrupt().
+#define TIMER0_TICKS_PER_ms (FREQ_SYS / 12000)
+#define TIMER0_RELOAD       ((uint16_t)(65536 - TIMER0_TICKS_PER_ms))
+
+// Idle clock, the lowest clock that timer0 still counts 1 ms with a 16-bit reload.
+// - idle() throttles only when FREQ_SYS is a multiple of it, an idle tick is then
+//   exactly IDLE_RATIO ticks of the system clock.
+#define IDLE_CLOCK_SEL 0x01  // 750KHz
+#define IDLE_FREQ      750000
+#define IDLE_RATIO     (FREQ_SYS / IDLE_FREQ)
+
 // Time in milliseconds
 //   2^32 / 1000 / 3600 / 24 = 49.71 days
 __data volatile uint32_t _SYSTEM_TIME = 0;
+__data volatile uint32_t _IDLE_TIME   = 0;  // Time spent in idle() in microseconds
+__data int8_t            _IDLE_CARRY  = 0;  // Ticks the next idle() owes, see idle()
+volatile __bit           _IDLE        = 0;
 
 void timer0_interrupt(void) __interrupt(INT_NO_TMR0)
 {
+    // Wake up from idle(), restore the system clock before reloading timer0.
+    if (_IDLE)
+    {
+        mcu_set_clock(MCU_CLOCK_SEL);
+        _IDLE = 0;
+    }
+
     // In Mode 1, timer0/1 interrupt is triggered when TH0/1 & TL0/1 changes from 0xFFFF to 0x0000.
     // After reset (bT0_CLK = 0), the timer0's internal clock frequency is MCU_Frequency/12.
     // Calculate TH & TL,
@@ -55,6 +77,104 @@ void timer0_interrupt(void) __interrupt(INT_NO_TMR0)
     _SYSTEM_TIME++;
 }
 
+// Time in microseconds
+// - The sub-millisecond part is the ticks timer0 counted since its last reload.
+// - 2^32 / 1000000 / 60 = 71.58 minutes before it overflows.
+uint32_t micros()
+{
+    uint32_t ms;
+    uint16_t ticks;
+    uint8_t  high;
+
+    disable_interrupt();
+    do
+    {
+        high  = TH0;
+        ticks = TL0;
+    } while (high != TH0);  // TL0 overflowed into TH0 while reading
+    ticks |= (uint16_t)high << 8;
+    ms = _SYSTEM_TIME;
+
+    if (TF0 && ticks < TIMER0_RELOAD)
+    {
+        // Timer0 overflowed but the interrupt is pending, the counter restarted from 0.
+        ms++;
+    }
+    else
+    {
+        ticks -= TIMER0_RELOAD;
+    }
+    enable_interrupt();
+
+#if FREQ_SYS == 12000000
+    return ms * 1000 + ticks;  // 1 tick per microsecond
+#else
+    return ms * 1000 + (uint32_t)ticks * 12000 / (FREQ_SYS / 1000);
+#endif
+}
+
+// Idle until the next timer0 tick
+// - The CH552 has no idle mode, and power-down only wakes up on pins, not on timers.
+//   Instead, the system clock is throttled to 750 KHz and timer0 interrupt restores it.
+// - The ticks left in the current millisecond are scaled down to the idle clock,
+//   so millis() keeps counting correctly.
+// - The scaled ticks are rounded, the rounding error is carried into the next idle
+//   period. A throttled millisecond is off by the carry it takes minus the carry it
+//   leaves, so the errors cancel and millis() and micros() are never off by more than
+//   the last carry, at most IDLE_RATIO / 2 ticks (8 us at 12 MHz). Truncating instead
+//   ended every throttled millisecond up to IDLE_RATIO - 1 ticks early.
+void idle()
+{
+#if FREQ_SYS > IDLE_FREQ && FREQ_SYS % IDLE_FREQ == 0
+    uint16_t remaining;
+    uint16_t idle_ticks;
+
+    disable_interrupt();
+    TR0       = 0;
+    remaining = 0 - (((uint16_t)TH0 << 8) | TL0);  // Ticks left before overflow
+    if (TF0 || remaining < IDLE_RATIO)
+    {
+        // The tick is pending or imminent.
+        TR0 = 1;
+        enable_interrupt();
+        return;
+    }
+
+    remaining += _IDLE_CARRY;  // At least IDLE_RATIO / 2, at least 1 idle tick
+    idle_ticks  = (remaining + IDLE_RATIO / 2) / IDLE_RATIO;
+    _IDLE_CARRY = (int8_t)(remaining - idle_ticks * IDLE_RATIO);  // -IDLE_RATIO / 2 to IDLE_RATIO / 2 - 1
+    remaining   = idle_ticks * IDLE_RATIO;
+
+#if FREQ_SYS == 12000000
+    _IDLE_TIME += remaining;  // 1 tick per microsecond
+#else
+    _IDLE_TIME += (uint32_t)remaining * 12000 / (FREQ_SYS / 1000);
+#endif
+
+    idle_ticks = 0 - idle_ticks;
+    TH0        = (uint8_t)(idle_ticks >> 8);
+    TL0        = (uint8_t)idle_ticks;
+    TR0        = 1;
+    mcu_set_clock(IDLE_CLOCK_SEL);
+    _IDLE = 1;
+    enable_interrupt();
+
+    while (_IDLE)
+        ;
+#endif
+}
+
+uint32_t idle_micros()
+{
+    uint32_t time;
+
+    disable_interrupt();
+    time = _IDLE_TIME;
+    enable_interrupt();
+
+    return time;
+}
+
 void delayMicroseconds(uint16_t us)
 {
 #ifdef FREQ_SYS
@@ -21,10 +21,15 @@ inline void timer_init()
     //   - The reset value of TMOD = 0x00
     //   - Set bT0_M1 = 0 and bT0_M0 = 1
     TMOD |= bT0_M0;
-    // 4. Start timer0
+    // 4. High priority, other interrupts, e.g. the I2C queue, do not delay the reload
+    PT0 = 1;
+    // 5. Start timer0
     TR0 = 1;
 }
 
-void timer0_interrupt(void) __interrupt(INT_NO_TMR0);
-void delay(uint16_t ms);
-void delayMicroseconds(uint16_t us);
+void     timer0_interrupt(void) __interrupt(INT_NO_TMR0);
+uint32_t micros();
+void     idle();
+uint32_t idle_micros();
+void     delay(uint16_t ms);
+void     delayMicroseconds(uint16_t us);
@@ -2,17 +2,21 @@
 #include <ch554.h>
 #include <encoder.h>
 #include <gpio.h>    // PIN_read(), PIN_input_PU()
+#include <i2c.h>     // I2C_init(), I2C_queue_interrupt(), I2C_queue_busy()
 #include <oled.h>    // OLED
 #include <system.h>  // mcu_config()
 #include <time.h>    // millis(), delay()
 
 #include "meter.h"
 
-#define RESET_PIN P34
+#define LONG_PRESS_ms 1000
 
 // __xdata const uint8_t start_sound[] = {1, C4, 1};
 
-__data uint32_t last_system_time = 0;
+__data uint32_t last_system_time   = 0;
+__data uint8_t  last_encoder_delta = 0;
+__data uint32_t button_time        = 0;
+__bit           button_down        = 0;
 
 void startup()
 {
@@ -20,6 +24,7 @@ void startup()
     mcu_config();
     delay(5);
 
+    I2C_init();  // Shared by the INA219s and the I2C OLED
     OLED_init();
     OLED_clear();
     meter_init();
@@ -34,20 +39,59 @@ void main()
 
     startup();
     // buzzer_play(start_sound);
+    if (!PIN_read(RESET_PIN))  // Reset button held at power-up
+    {
+        meter_calibrate();
+        OLED_clear();
+    }
     meter_display();
+    OLED_setYield(meter_service);  // Read pending samples between display chunks
 
     while (1)
     {
+        // Reset button, a short press resets, a long press switches the view.
+        // No debounce, it is not necessary as it can be reset multiple times.
         if (!PIN_read(RESET_PIN))  // Reset button pressed
         {
-            delay(100);  // Naive debounce, not necessary as it can be reset multiple times.
-            meter_reset();
+            if (!button_down)
+            {
+                button_down = 1;
+                button_time = millis();
+            }
+        }
+        else if (button_down)  // Reset button released
+        {
+            button_down = 0;
+            if (millis() - button_time >= LONG_PRESS_ms)
+            {
+                meter_next_view();
+            }
+            else
+            {
+                meter_reset();
+            }
         }
 
-        if (millis() - last_system_time >= 20)  // Refresh every 20ms.
+        if (encoder_process())  // Encoder turned, select the ADC profile
+        {
+            meter_change_profile((int8_t)(encoder_get_delta() - last_encoder_delta));
+            last_encoder_delta = encoder_get_delta();
+        }
+
+#ifdef METER_SAMPLING_CONVERSION_READY
+        meter_run();  // Return immediately if no new conversion is ready and no refresh is due.
+#ifdef METER_LOW_POWER
+        if (!I2C_queue_busy())
+        {
+            idle();  // Throttle the MCU until the next millisecond, not while the display is sent
+        }
+#endif
+#else
+        if (millis() - last_system_time >= 20)  // Sample every 20ms.
         {
             last_system_time = millis();
             meter_run();
         }
+#endif
     }
 }
@@ -1,6 +1,7 @@
 #include "meter.h"
 
 #include <ch554.h>
+#include <flash.h>
 #include <gpio.h>
 #include <ina219.h>
 #include <oled.h>
@@ -8,11 +9,13 @@
 #include <time.h>
 
 #include <font_5x8.h>
+#include <font_12x24.h>
 #include <font_8x16.h>
 
 __data uint8_t shunt        = 0;  // Use the smallest shunt resistor by default
-__data uint8_t recalibrate  = 0;
+__data uint8_t profile      = INA219_PROFILE_AVG_16;
 __bit          undervoltage = 0;
+__bit          locked_out   = 0;  // The undervoltage lockout is shown
 
 __data int32_t shunt_voltage_uV = 0;
 __data int32_t current_uA       = 0;
@@ -21,26 +24,293 @@ __data int32_t power_uW         = 0;
 __data int32_t max_current_uA   = 0;
 __data int32_t min_current_uA   = 0x7FFFFFFF;
 
-__code char str_lockout[] = "         -";
+// Conversion bookkeeping
+__data uint32_t last_conversion_time   = 0;  // On the conversion schedule, in microseconds
+__data uint16_t dropped_conversions    = 0;  // Conversions completed but never read
+__data uint16_t duplicated_conversions = 0;  // Conversions read more than once
+__bit           resync_conversion      = 1;  // Skip dropped conversion check after a blind spot
+__bit           discard_conversion     = 0;  // The next conversion may straddle a shunt switch
+__bit           sample_pending         = 0;  // Acquired by meter_service(), not processed yet
+__bit           shunt_pending          = 0;  // Switched by meter_service(), not drawn yet
 
-void meter_switch_to_shunt(uint8_t to_shunt)
+// Samples of rail 0 averaged over a display interval, see meter_display_readings()
+// - At most 3.3 A x 512 samples, the sums and the count are halved at the limit.
+// - The power of each sample is summed per shunt as the power product, see
+//   INA219_get_power_product(), and scaled once per display interval. Up to 2^29 x 512
+//   needs 38 bits, the low 32 bits and a high byte. Only non-negative currents are
+//   accumulated.
+#define METER_AVERAGE_SAMPLES_MAX 512
+#define METER_DISPLAY_INTERVAL_ms (1000 / METER_DISPLAY_RATE_Hz)
+__xdata int32_t  sum_current_uA     = 0;
+__xdata int32_t  sum_bus_voltage_mV = 0;
+__xdata uint32_t sum_power[3]       = {0, 0, 0};  // Low 32 bits, per shunt
+__xdata uint8_t  sum_power_high[3]  = {0, 0, 0};  // Bits 32 to 39
+__xdata uint16_t averaged_samples   = 0;
+__xdata int32_t  interval_min_uA    = 0;  // The lowest current of the averaged samples
+__xdata int32_t  interval_max_uA    = 0;  // The highest current of the averaged samples
+__xdata uint32_t last_display_time  = 0;
+
+#ifdef METER_SHUNT_STREAMING
+__data uint8_t stream_samples = 0;  // Shunt-only samples left before the next bus voltage refresh
+#endif
+
+#ifdef METER_LOW_POWER
+__data uint32_t last_trigger_time = 0;
+__data uint32_t last_idle_time    = 0;  // idle_micros() at the last trigger
+__bit           triggered         = 0;  // A single-shot conversion is in progress
+#endif
+
+// Rails, the INA219s sharing the I2C bus, sampled round-robin
+// - Rail 0 is the on-board INA219 with the switched shunt resistors.
+// - The other rails use shunt 0 LSBs, i.e. a 0.1 Ω shunt like on most INA219 breakouts.
+__xdata INA219_device rails[METER_RAILS];
+__xdata int32_t       rail_bus_voltage_mV[METER_RAILS];
+__xdata int32_t       rail_current_uA[METER_RAILS];
+__data uint8_t        rail = 0;  // The rail sampled last
+__code const uint8_t  rail_addrs[]    = {INA219_ADDR, 0x40 << 1, 0x41 << 1, 0x44 << 1};
+__code char           rail_names[][4] = {"IN", "3V3", "RF", "AUX"};
+
+// Trim of the shunt resistors of rail 0, see Calibration 9. in ina219.h
+// - Data flash layout: magic, trims[], checksum of trims[].
+typedef struct meter_trim
 {
-    INA219_switch_shunt(to_shunt);
-    shunt = to_shunt;
+    int16_t gain;    // Gain error in Q15
+    int16_t offset;  // Offset in shunt voltage register LSBs
+} meter_trim;
+
+#define METER_TRIM_FLASH_ADDR 0
+#define METER_TRIM_MAGIC      0xA5
+__xdata meter_trim trims[3];
 
+// Views, switched by a long press of the reset button
+#define METER_VIEW_MAIN  0  // Readings of rail 0
+#define METER_VIEW_GRAPH 1  // Current of rail 0 over time
+#define METER_VIEW_RAILS 2  // Voltage and current of every rail
+#define METER_VIEW_DIAG  3  // Conversion counters of rail 0 and I2C counters
+__data uint8_t view = METER_VIEW_MAIN;
+
+// Graph view, the current of rail 0 on a log scale sweeping to the right
+// - Pages 1 to 7 are the graph, 8 rows per decade from 1 uA at the bottom row to 10 A,
+//   across all 3 shunt ranges. Page 0 shows the latest average.
+// - A column per display interval spans the lowest to the highest sample of the interval.
+//   The columns are a ring, the new one overwrites the oldest and the next column is
+//   blanked as the cursor. The SSD1306 cannot be read back and the graph has no room for
+//   a history in xdata, so nothing is redrawn, each interval sends 2 columns.
+// - A dot marks every decade on every 8th column.
+#define METER_GRAPH_PAGE    1
+#define METER_GRAPH_PAGES   7
+#define METER_GRAPH_DECADE  8  // Rows per decade
+__code const uint32_t graph_levels_uA[] = {  // The lowest current of rows 1 to 55, 10^(row / 8)
+    1,      2,      2,      3,      4,       6,       7,       10,      13,      18,      24,
+    32,     42,     56,     75,     100,     133,     178,     237,     316,     422,     562,
+    750,    1000,   1334,   1778,   2371,    3162,    4217,    5623,    7499,    10000,   13335,
+    17783,  23714,  31623,  42170,  56234,   74989,   100000,  133352,  177828,  237137,  316228,
+    421697, 562341, 749894, 1000000, 1333521, 1778279, 2371374, 3162278, 4216965, 5623413, 7498942};
+__xdata uint8_t graph_column = 0;  // The column of the next interval
+
+// The reading shown on each page, see reading_changed()
+__xdata int32_t shown_readings[8];
+__data uint8_t  shown_pages  = 0;  // Bit per page, set when shown_readings[page] is on the screen
+__data uint16_t shown_errors = 0;  // OLED_get_errors() when shown_pages was last valid
+
+__code char str_lockout[]     = "         -";
+char        str_reading[11];  // See format_reading()
+__code char str_profiles[][5] = {"FAST", "12b ", "x4  ", "x16 ", "x128"};  // See INA219_PROFILE_*
+
+void meter_display_shunt()
+{
     OLED_setFont(&OLED_FONT_8x16);
     OLED_setColor(0);
     OLED_setCursor(0, 0);
     OLED_write('0' + shunt);
     OLED_setColor(1);
+}
+
+// Switch the shunt of rail 0 without drawing, see meter_switch_to_shunt()
+void meter_select_shunt(uint8_t to_shunt)
+{
+    INA219_switch_shunt(to_shunt);
+    INA219_set_trim(trims[to_shunt].gain, trims[to_shunt].offset);
+    shunt = to_shunt;
+
+    // The configuration write restarts the conversion and clears CNVR, the first
+    // conversion is still discarded in case it straddles the switch of the MOSFETs.
+    // Sampling goes on, no blocking wait.
+    discard_conversion   = 1;
+    last_conversion_time = micros();  // The next conversion is due a conversion time later
+}
+
+void meter_switch_to_shunt(uint8_t to_shunt)
+{
+    meter_select_shunt(to_shunt);
+
+    if (view == METER_VIEW_MAIN)
+    {
+        meter_display_shunt();
+    }
+}
+
+void meter_display_profile()
+{
+    OLED_setFont(&OLED_FONT_5x8);
+    OLED_setCursor(2, 0);
+    OLED_print(str_profiles[profile]);
+}
+
+// Step through the ADC profiles of all rails, e.g. by the rotary encoder
+void meter_change_profile(int8_t steps)
+{
+    profile = (uint8_t)(profile + INA219_PROFILES + steps % INA219_PROFILES) % INA219_PROFILES;
+    for (uint8_t i = METER_RAILS; i;)
+    {
+        INA219_select(&rails[--i]);
+        INA219_set_profile(profile);
+    }  // Rail 0 is selected at last
 
-    delay(100);  // Wait for INA219 to get new data
+    if (view == METER_VIEW_MAIN)
+    {
+        meter_display_profile();
+    }
+    last_conversion_time = micros();  // The configuration write restarts the conversion
 }
 
 void meter_reset()
 {
-    max_current_uA = 0;
-    min_current_uA = 0x7FFFFFFF;
+    max_current_uA         = 0;
+    min_current_uA         = 0x7FFFFFFF;
+    dropped_conversions    = 0;
+    duplicated_conversions = 0;
+}
+
+uint16_t meter_get_dropped_conversions()
+{
+    return dropped_conversions;
+}
+
+uint16_t meter_get_duplicated_conversions()
+{
+    return duplicated_conversions;
+}
+
+// I2C transactions of all rails retried after a NAK, see INA219_RETRIES
+uint16_t meter_get_bus_retries()
+{
+    uint16_t retries = 0;
+
+    for (uint8_t i = METER_RAILS; i;)
+    {
+        INA219_select(&rails[--i]);
+        retries += INA219_get_retries();
+    }  // Rail 0 is selected at last
+
+    return retries;
+}
+
+// I2C transactions of all rails failed after all retries
+uint16_t meter_get_bus_errors()
+{
+    uint16_t errors = 0;
+
+    for (uint8_t i = METER_RAILS; i;)
+    {
+        INA219_select(&rails[--i]);
+        errors += INA219_get_errors();
+    }  // Rail 0 is selected at last
+
+    return errors;
+}
+
+// Count the conversions missed since the last consumed conversion
+// - The INA219 completes a conversion every conversion time of the active profile,
+//   so the whole number of periods elapsed minus one is the number of dropped conversions.
+// - last_conversion_time follows the conversion schedule, it advances by whole periods.
+//   A read lands a little after its conversion, a read time anchor would drift later
+//   every sample until a conversion is skipped with the reads still 1 period apart.
+// - The schedule is unknown after a blind spot, the read time is the new anchor.
+// - A poll that finds no conversion moves the schedule later, see meter_acquire().
+void meter_track_conversion()
+{
+    uint32_t now             = micros();
+    uint32_t conversion_time = INA219_get_conversion_time_us();
+    uint16_t periods;
+
+    if (resync_conversion)
+    {
+        resync_conversion    = 0;
+        last_conversion_time = now;
+        return;
+    }
+
+    // At least the consumed conversion completed since the last one
+    periods = (uint16_t)((now - last_conversion_time) / conversion_time);
+    if (periods > 1)
+    {
+        dropped_conversions += periods - 1;
+        last_conversion_time += (periods - 1) * conversion_time;
+    }
+
+    last_conversion_time += conversion_time;
+    if ((int32_t)(now - last_conversion_time) < 0)
+    {
+        last_conversion_time = now;  // The conversion completed before its read
+    }
+}
+
+// The due conversion is not ready, it completes after now
+// - The INA219 runs a little slower than its nominal conversion time, the schedule
+//   follows it and the next poll is 1/16 of a conversion time later.
+void meter_track_late_conversion()
+{
+    uint32_t conversion_time = INA219_get_conversion_time_us();
+
+    last_conversion_time = micros() - conversion_time + (conversion_time >> 3);
+}
+
+// Return 1 if the next conversion of rail 0 may be ready
+// - Due 1/16 of a conversion time early, the conversion time of the INA219 is only
+//   nominal. The CNVR poll decides, see meter_acquire().
+__bit meter_conversion_due()
+{
+    uint32_t conversion_time = INA219_get_conversion_time_us();
+
+    return micros() - last_conversion_time >= conversion_time - (conversion_time >> 4);
+}
+
+uint8_t meter_trim_checksum()
+{
+    __xdata uint8_t* p   = (__xdata uint8_t*)trims;
+    uint8_t          sum = METER_TRIM_MAGIC;
+
+    for (uint8_t i = sizeof(trims); i; i--)
+    {
+        sum += *p++;
+    }
+
+    return sum;
+}
+
+// Load the trims from the data flash, a blank or corrupted flash loads no trim.
+void meter_load_trims()
+{
+    flash_read_block(METER_TRIM_FLASH_ADDR + 1, (__xdata uint8_t*)trims, sizeof(trims));
+    if (flash_read(METER_TRIM_FLASH_ADDR) == METER_TRIM_MAGIC &&
+        flash_read(METER_TRIM_FLASH_ADDR + 1 + sizeof(trims)) == meter_trim_checksum())
+    {
+        return;
+    }
+
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        trims[i].gain   = 0;
+        trims[i].offset = 0;
+    }
+}
+
+__bit meter_save_trims()
+{
+    return flash_write_block(METER_TRIM_FLASH_ADDR + 1, (__xdata uint8_t*)trims, sizeof(trims)) &&
+           flash_write(METER_TRIM_FLASH_ADDR + 1 + sizeof(trims), meter_trim_checksum()) &&
+           flash_write(METER_TRIM_FLASH_ADDR, METER_TRIM_MAGIC);
 }
 
 void meter_init()
@@ -53,21 +323,33 @@ void meter_init()
     PIN_low(SHUNT1_EN);
     PIN_low(SHUNT2_EN);
 
-    INA219_init();
+    meter_load_trims();
+
+    for (uint8_t i = METER_RAILS; i;)
+    {
+        --i;
+        INA219_select(&rails[i]);
+        INA219_init(rail_addrs[i]);
+    }  // Rail 0 is selected at last
+
+#ifdef METER_LOW_POWER
+    INA219_set_mode(INA219_CONFIG_MODE_POWER_DOWN);
+#endif
     PIN_high(SHUNT0_EN);
     meter_switch_to_shunt(0);
 }
 
 inline void meter_display()
 {
+    shown_pages = 0;  // The screen was cleared
     OLED_setFont(&OLED_FONT_8x16);
     OLED_setCursor(0, 120);
     OLED_write('V');
-    OLED_setCursor(2, 120);
+    OLED_setCursor(3, 120);
     OLED_write('A');
-    OLED_setCursor(4, 120);
-    OLED_write('W');
     OLED_setFont(&OLED_FONT_5x8);
+    OLED_setCursor(5, 118);
+    OLED_write('W');
     OLED_setCursor(6, 0);
     OLED_print("MAX");
     OLED_setCursor(6, 118);
@@ -76,6 +358,8 @@ inline void meter_display()
     OLED_print("MIN");
     OLED_setCursor(7, 118);
     OLED_write('A');
+    meter_display_shunt();
+    meter_display_profile();
 }
 
 inline void meter_undervoltage_lockout()
@@ -88,35 +372,37 @@ inline void meter_undervoltage_lockout()
         meter_switch_to_shunt(0);
     }
 
+    // Samples before the lockout are not shown after it
+    sum_bus_voltage_mV = 0;
+    sum_current_uA     = 0;
+    averaged_samples   = 0;
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        sum_power[i]      = 0;
+        sum_power_high[i] = 0;
+    }
+
+    if (view != METER_VIEW_MAIN)
+    {
+        return;
+    }
+
+    shown_pages = 0;  // The readings are replaced
     OLED_setFont(&OLED_FONT_8x16);
     OLED_setCursor(0, 27);
     OLED_print(str_lockout);
+    OLED_setFont(&OLED_FONT_12x24);
     OLED_setCursor(2, 27);
-    OLED_print(str_lockout);
-    OLED_setCursor(4, 27);
-    OLED_print(str_lockout);
+    OLED_print(str_lockout + 3);
     OLED_setFont(&OLED_FONT_5x8);
+    OLED_setCursor(5, 47);
+    OLED_print(str_lockout);
     OLED_setCursor(6, 47);
     OLED_print(str_lockout);
     OLED_setCursor(7, 47);
     OLED_print(str_lockout);
 }
 
-inline __bit meter_check_calibration()
-{
-    // Sometimes, INA219 can return the shunt voltage but the current is zero,
-    // it looks like the current LSB is missing, recalibrate it.
-    if (current_uA == 0 && shunt_voltage_uV != 0)
-    {
-        INA219_init();
-        delay(100);
-        recalibrate++;
-        return 1;
-    }
-
-    return 0;
-}
-
 void meter_check_undervoltage()
 {
     if (undervoltage)
@@ -128,13 +414,40 @@ void meter_check_undervoltage()
     }
     else if (bus_voltage_mV < 1200 || current_uA < 0)
     {
-        undervoltage = 1;
-        meter_undervoltage_lockout();
+        undervoltage = 1;  // Shown by meter_run()
     }
 }
 
+// The reading clipped, the current is too large for shunt 1 or 2 by an unknown amount,
+// switch straight to shunt 0 instead of stepping through shunt 1.
+// - Nothing is drawn, it also runs between display chunks, see meter_service().
+__bit meter_check_overflow()
+{
+    if (shunt != 0 && INA219_overflow())
+    {
+        PIN_high(SHUNT0_EN);
+        PIN_low(SHUNT1_EN);
+        PIN_low(SHUNT2_EN);
+        meter_select_shunt(0);
+
+        return 1;
+    }
+
+    return 0;
+}
+
 __bit meter_check_shunt()
 {
+    if (meter_check_overflow())
+    {
+        if (view == METER_VIEW_MAIN)
+        {
+            meter_display_shunt();
+        }
+
+        return 1;
+    }
+
     if (shunt == 0)
     {
         // Switch from shunt 0 to shunt 1 if current is <= 80 mA
@@ -184,132 +497,929 @@ __bit meter_check_shunt()
     return 0;
 }
 
-// Print the reading and unit
-// - Print the reading in proper unit, either V/A/W or mV/mA/mW.
+// Powers of ten for splitting a reading into digits, see format_reading()
+__code const uint32_t powers_of_ten[] = {1000000000, 100000000, 10000000, 1000000, 100000,
+                                         10000,      1000,      100,      10};
+
+// Return 1 if the reading is to be drawn on the page, nothing is formatted or sent while
+// it stays within deadband of the one shown.
+__bit reading_changed(uint8_t page, int32_t reading, uint16_t deadband)
+{
+    uint8_t  mask = 1 << page;
+    int32_t  shown;
+    uint32_t value;
+
+    // A failed display transaction may have lost any row
+    if (OLED_get_errors() != shown_errors)
+    {
+        shown_errors = OLED_get_errors();
+        shown_pages  = 0;
+    }
+
+    // Skip the row if the reading shown is close enough
+    if (shown_pages & mask)
+    {
+        shown = shown_readings[page];
+        value = reading > shown ? (uint32_t)reading - (uint32_t)shown : (uint32_t)shown - (uint32_t)reading;
+        if (value <= deadband)
+        {
+            return 0;
+        }
+    }
+    shown_readings[page] = reading;
+    shown_pages |= mask;
+
+    return 1;
+}
+
+// Format the reading into str_reading, return the unit prefix
+// - The reading in proper unit, either V/A/W or mV/mA/mW.
 //   - [0, 1000000)   ->  xxx.yy  mV/mA/mW
 //   - [1000000, Max] -> xxxx.yyy V/A/W
 // - Handling at most 10 digits including floating point and minus sign.
 //   - xxxxxx.yyy
 //   - -xxxxx.yyy
 // - Right aligned and fill the remain digits with space ' '.
-void print_reading(uint8_t page, uint8_t reading_column, uint8_t unit_column, int32_t reading)
+// - Matches the former division-based print_reading() digit for digit and unit for unit,
+//   checked on a host build (gcc, both functions side by side, strcmp of the string and
+//   compare of the unit) for every int32_t from -2147483647 to 2147483647. INT32_MIN
+//   overflowed the old negation and is not comparable, it gives " -2147.483" here.
+char format_reading(int32_t reading)
 {
-    static char str[11];
-    uint8_t     decimal_precision;
-    uint8_t     digits = 10;
-    __bit       neg    = 0;
+    char     digits[10];
+    uint32_t value;
+    uint8_t  i, first, last;
+    uint8_t  pos = 10;
+    char     unit, d;
+    __bit    neg = 0;
 
-    // Handle negative number
+    // Handle negative number, the magnitude of INT32_MIN fits in uint32_t
+    value = reading;
     if (reading < 0)
     {
-        neg     = 1;
-        reading = -reading;
+        neg   = 1;
+        value = -value;
     }
 
-    // Calculate and print the unit of the reading
-    if (reading < 1000)  // uV/uA/uW
+    // Calculate the unit of the reading and the last digit shown
+    if (value < 1000)  // uV/uA/uW
     {
-        OLED_setCursor(page, unit_column);
-        OLED_write('u');
-        decimal_precision = 0;
+        unit = 'u';
+        last = 10;
     }
-    else if (reading < 1000000)  // mV/mA/mW
+    else if (value < 1000000)  // mV/mA/mW
     {
-        OLED_setCursor(page, unit_column);
-        OLED_write('m');
-        decimal_precision = 3;
+        unit = 'm';
+        last = 10;
     }
-    else  // V/A/W
+    else  // V/A/W, drop the last 3 digits
     {
-        OLED_setCursor(page, unit_column);
-        OLED_write(' ');
-        decimal_precision = 3;
-        reading /= 1000;
+        unit = ' ';
+        last = 7;
     }
 
-    str[digits] = '\0';  // End of the string.
-
-    // Calculate the fractional part
-    if (decimal_precision)
+    // Split into 10 decimal digits, most significant first. Subtracting powers
+    // of ten avoids the 32-bit software division, at most 9 rounds per digit.
+    for (i = 0; i < 9; ++i)
     {
-        while (decimal_precision)
+        d = '0';
+        while (value >= powers_of_ten[i])
         {
-            str[--digits] = reading % 10 + '0';
-            reading /= 10;
-            --decimal_precision;
+            value -= powers_of_ten[i];
+            ++d;
         }
-
-        // Place the decimal point
-        str[--digits] = '.';
+        digits[i] = d;
     }
+    digits[9] = '0' + (uint8_t)value;
 
-    // Calculate the integer part
-    if (reading == 0)
+    str_reading[pos] = '\0';  // End of the string.
+
+    // Copy the fractional part and place the decimal point
+    if (unit != 'u')
     {
-        str[--digits] = '0';
+        str_reading[--pos] = digits[--last];
+        str_reading[--pos] = digits[--last];
+        str_reading[--pos] = digits[--last];
+        str_reading[--pos] = '.';
     }
-    else
+
+    // Copy the integer part without leading zeros, at least one digit
+    for (first = 0; first < last - 1 && digits[first] == '0'; ++first)
+        ;
+    while (last > first)
     {
-        while (reading)
-        {
-            str[--digits] = reading % 10 + '0';
-            reading /= 10;
-        }
+        str_reading[--pos] = digits[--last];
     }
 
     // Place the minus sign
     if (neg)
     {
-        str[--digits] = '-';
+        str_reading[--pos] = '-';
     }
 
     // Fill in spaces
-    while (digits)
+    while (pos)
     {
-        str[--digits] = ' ';
+        str_reading[--pos] = ' ';
     }
 
+    return unit;
+}
+
+// Print the reading and unit
+// - The unit prefix and label follow at unit_column in the same row, only changed
+//   glyphs are sent.
+void print_reading(uint8_t page, uint8_t reading_column, uint8_t unit_column, char label, int32_t reading,
+                   uint16_t deadband)
+{
+    char unit;
+
+    if (!reading_changed(page, reading, deadband))
+    {
+        return;
+    }
+    unit = format_reading(reading);
+
+    // The reading, unit prefix and label in one data transaction.
     OLED_setCursor(page, reading_column);
-    OLED_print(str);
+    OLED_startRow();
+    OLED_print(str_reading);
+    OLED_skipTo(unit_column);
+    OLED_write(unit);
+    OLED_write(label);
+    OLED_endRow();
 }
 
-void meter_run()
+// Print the primary reading in the 12x24 font, see print_reading()
+// - The last 7 characters, a non-negative current up to xxx.yyy mA.
+// - The unit prefix and label in the 8x16 font on the lower 2 pages.
+void print_big_reading(uint8_t page, uint8_t reading_column, uint8_t unit_column, char label, int32_t reading,
+                       uint16_t deadband)
 {
-    shunt_voltage_uV = INA219_get_shunt_voltage_uV();
-    current_uA       = INA219_get_current_uA();
-    bus_voltage_mV   = INA219_get_bus_voltage_mV();
-    power_uW         = INA219_get_power_uW();
+    char unit;
 
-    if (meter_check_calibration())
+    if (!reading_changed(page, reading, deadband))
     {
         return;
     }
+    unit = format_reading(reading);
+
+    OLED_setFont(&OLED_FONT_12x24);
+    OLED_setCursor(page, reading_column);
+    OLED_print(str_reading + 3);
+    OLED_setFont(&OLED_FONT_8x16);
+    OLED_setCursor(page + 1, unit_column);
+    OLED_startRow();
+    OLED_write(unit);
+    OLED_write(label);
+    OLED_endRow();
+}
+
+// Print a counter right aligned in the reading column, see print_reading()
+void print_count(uint8_t page, uint16_t count)
+{
+    uint8_t pos = 10;
+
+    if (!reading_changed(page, count, 0))
+    {
+        return;
+    }
+
+    str_reading[pos] = '\0';
+    do
+    {
+        str_reading[--pos] = '0' + count % 10;
+        count /= 10;
+    } while (count);
+    while (pos)
+    {
+        str_reading[--pos] = ' ';
+    }
+
+    OLED_setCursor(page, 47);
+    OLED_print(str_reading);
+}
+
+// Acquire a sample, return 1 if a new conversion is consumed.
+#ifdef METER_LOW_POWER
+// Show the percentage of time the MCU ran at full speed since the last trigger
+void meter_display_awake(uint32_t now)
+{
+    static char str[5];
+    uint32_t    idle_time = idle_micros();
+    uint32_t    idle      = (idle_time - last_idle_time) / ((now - last_trigger_time) * 10);  // In percent
+    uint8_t     percent   = idle < 100 ? 100 - (uint8_t)idle : 0;
+
+    last_idle_time = idle_time;
+
+    str[0] = percent >= 100 ? '1' : ' ';
+    str[1] = percent >= 10 ? '0' + percent / 10 % 10 : ' ';
+    str[2] = '0' + percent % 10;
+    str[3] = '%';
+    str[4] = '\0';
+
+    if (view == METER_VIEW_MAIN)
+    {
+        OLED_setFont(&OLED_FONT_5x8);
+        OLED_setCursor(3, 0);
+        OLED_print(str);
+    }
+}
+#endif
+
+__bit meter_acquire()
+{
+#ifdef METER_LOW_POWER
+    if (!triggered)
+    {
+        uint32_t now = millis();
+        if (now - last_trigger_time < METER_LOW_POWER_INTERVAL_ms)
+        {
+            return 0;
+        }
+
+        meter_display_awake(now);
+        last_trigger_time = now;
+
+        // Writing the mode starts a single-shot conversion and clears CNVR.
+        INA219_set_mode(INA219_CONFIG_MODE_BOTH_TRIGGERED);
+        triggered = 1;
+        return 0;
+    }
+
+    if (!INA219_conversion_ready())
+    {
+        return 0;
+    }
+
+    // Every conversion is triggered by the meter, no conversion can be dropped.
+    triggered        = 0;
+    shunt_voltage_uV = INA219_get_shunt_voltage_uV();
+    INA219_set_mode(INA219_CONFIG_MODE_POWER_DOWN);
+    bus_voltage_mV = INA219_get_latched_bus_voltage_mV();
+    current_uA     = INA219_get_current_uA();
+
+    return 1;
+#else
+#ifdef METER_SHUNT_STREAMING
+    if (stream_samples)
+    {
+        // Shunt-only streaming, each sample is a single read-only transaction.
+        if (micros() - last_conversion_time < INA219_get_conversion_time_us())
+        {
+            return 0;
+        }
+        meter_track_conversion();
+
+        shunt_voltage_uV = INA219_get_shunt_voltage_uV();
+        current_uA       = INA219_get_current_uA();
+
+        // The first read may still hold the last conversion of both-mode, discard it.
+        if (stream_samples-- > METER_BUS_REFRESH_SAMPLES)
+        {
+            return 0;
+        }
+
+        if (stream_samples == 0)
+        {
+            INA219_set_mode(INA219_CONFIG_MODE_BOTH_CONTINUOUS);  // Refresh the bus voltage
+            last_conversion_time = micros();                       // The conversion restarts
+        }
+
+        return 1;
+    }
+#endif
+
+#ifdef METER_SAMPLING_CONVERSION_READY
+    if (!meter_conversion_due())
+    {
+        return 0;  // Not due yet, avoid polling the bus back-to-back
+    }
+#endif
+
+    // The bus voltage register is read first for the CNVR bit, CNVR is cleared after
+    // the shunt voltage is read, so a conversion is never consumed twice.
+    if (INA219_conversion_ready())
+    {
+        meter_track_conversion();
+    }
+    else
+    {
+#ifdef METER_SAMPLING_CONVERSION_READY
+        meter_track_late_conversion();
+        return 0;  // No new conversion yet
+#else
+        duplicated_conversions++;
+#endif
+    }
+
+    // 3 register transfers per sample, each with a pointer write: the bus voltage above,
+    // the shunt voltage, then the power register read to clear CNVR, or the
+    // configuration write that starts the stream. Current and power are derived from
+    // the shunt and bus voltage registers.
+    shunt_voltage_uV = INA219_get_shunt_voltage_uV();
+#ifdef METER_SHUNT_STREAMING
+    INA219_start_shunt_stream();  // Clears CNVR as well
+    stream_samples       = METER_BUS_REFRESH_SAMPLES + 1;  // The first one is discarded
+    last_conversion_time = micros();                        // Read a conversion time after the mode change
+#else
+    INA219_clear_conversion_ready();
+#endif
+    bus_voltage_mV = INA219_get_latched_bus_voltage_mV();
+    current_uA     = INA219_get_current_uA();
+
+    return 1;
+#endif
+}
+
+void meter_track_extremes()
+{
+    if (current_uA > max_current_uA)
+    {
+        max_current_uA = current_uA;
+    }
+
+    if (current_uA < min_current_uA)
+    {
+        min_current_uA = current_uA;
+    }
+}
+
+// Acquisition task of rail 0, runs at the conversion rate
+// - Return 1 if a new conversion is consumed and usable.
+// - Track the extremes and accumulate the sample for the display task, except under
+//   undervoltage or when the shunt voltage clipped.
+// - Draws nothing, it also runs between display chunks.
+__bit meter_sample()
+{
+    uint32_t power;
+
+    if (!meter_acquire())
+    {
+        return 0;
+    }
+
+    if (discard_conversion)  // Consumed but not used, see meter_select_shunt()
+    {
+        discard_conversion = 0;
+        return 0;
+    }
 
     meter_check_undervoltage();
+    if (undervoltage || INA219_overflow())
+    {
+        return 1;
+    }
+
+    meter_track_extremes();
+
+    if (!averaged_samples || current_uA < interval_min_uA)
+    {
+        interval_min_uA = current_uA;
+    }
+    if (!averaged_samples || current_uA > interval_max_uA)
+    {
+        interval_max_uA = current_uA;
+    }
 
-    if (!undervoltage)
+    sum_current_uA += current_uA;
+    sum_bus_voltage_mV += bus_voltage_mV;
+    power = INA219_get_power_product();
+    sum_power[shunt] += power;
+    if (sum_power[shunt] < power)  // Carry
     {
-        if (meter_check_shunt())  // Shunt changed
+        ++sum_power_high[shunt];
+    }
+    if (++averaged_samples == METER_AVERAGE_SAMPLES_MAX)
+    {
+        sum_current_uA >>= 1;
+        sum_bus_voltage_mV >>= 1;
+        for (uint8_t i = 0; i < 3; i++)
         {
-            return;
+            sum_power[i] = (sum_power[i] >> 1) | ((uint32_t)(sum_power_high[i] & 1) << 31);
+            sum_power_high[i] >>= 1;
         }
+        averaged_samples >>= 1;
+    }
+
+    return 1;
+}
 
-        if (current_uA > max_current_uA)
+// Acquire a due conversion of rail 0 between display chunks, see OLED_setYield()
+// - A long display update no longer leaves a conversion to go stale, the sample is
+//   accumulated within a chunk, the shunt is checked by the next meter_run().
+// - A clipped reading switches to shunt 0 right away, so no more clipped samples are
+//   taken during the update. Clipped samples are never accumulated, see meter_sample().
+//   The shunt is drawn by the next meter_run().
+// - The readings shown by the running update may be newer than the ones shown before.
+void meter_service()
+{
+#if defined(METER_SAMPLING_CONVERSION_READY) && !defined(METER_LOW_POWER)
+    if (!meter_conversion_due())
+    {
+        return;  // Not due yet, avoid polling the bus between every chunk
+    }
+
+    INA219_select(&rails[0]);  // Another rail may be selected by meter_run_rail()
+    if (meter_sample())
+    {
+        if (!undervoltage && meter_check_overflow())
+        {
+            shunt_pending = 1;  // The clipped sample is not checked again by meter_run()
+        }
+        else
         {
-            max_current_uA = current_uA;
+            sample_pending = 1;
         }
+    }
+#endif
+}
 
-        if (current_uA < min_current_uA)
+// Rails view, 2 pages per rail with the voltage and current
+void meter_display_rails()
+{
+    uint8_t page = 0;
+
+    shown_pages = 0;  // The screen was cleared
+    OLED_setFont(&OLED_FONT_5x8);
+    for (uint8_t i = 0; i < METER_RAILS; i++, page += 2)
+    {
+        OLED_setCursor(page, 0);
+        OLED_print(rail_names[i]);
+        OLED_setCursor(page, 118);
+        OLED_write('V');
+        OLED_setCursor(page + 1, 118);
+        OLED_write('A');
+    }
+}
+
+void meter_display_rail(uint8_t i)
+{
+    OLED_setFont(&OLED_FONT_5x8);
+    print_reading(i << 1, 47, 112, 'V', rail_bus_voltage_mV[i] * 1000, METER_DEADBAND_uV);
+    print_reading((i << 1) + 1, 47, 112, 'A', rail_current_uA[i], METER_DEADBAND_uA);
+}
+
+#if METER_RAILS > 1
+// Sample one of the other rails, a conversion is consumed once like rail 0.
+// - The latest conversion is shown, see meter_display_readings().
+void meter_run_rail(uint8_t i)
+{
+    INA219_select(&rails[i]);
+    if (INA219_conversion_ready())
+    {
+        INA219_get_shunt_voltage_uV();
+        INA219_clear_conversion_ready();
+        rail_bus_voltage_mV[i] = INA219_get_latched_bus_voltage_mV();
+        rail_current_uA[i]     = INA219_get_current_uA();
+    }
+    INA219_select(&rails[0]);
+}
+#endif
+
+// Diagnostics view, the labels of the counters
+void meter_display_diag()
+{
+    shown_pages = 0;  // The screen was cleared
+    OLED_setFont(&OLED_FONT_5x8);
+    OLED_setCursor(0, 0);
+    OLED_print("DROP");
+    OLED_setCursor(1, 0);
+    OLED_print("DUP");
+    OLED_setCursor(2, 0);
+    OLED_print("RETRY");
+    OLED_setCursor(3, 0);
+    OLED_print("ERR");
+}
+
+// Diagnostics view, the conversion counters since the last reset, see meter_reset(),
+// and the I2C counters of all rails since power-up
+void meter_display_counters()
+{
+    OLED_setFont(&OLED_FONT_5x8);
+    print_count(0, meter_get_dropped_conversions());
+    print_count(1, meter_get_duplicated_conversions());
+    print_count(2, meter_get_bus_retries());
+    print_count(3, meter_get_bus_errors());
+}
+
+// Graph view, the header on page 0, the graph starts blank at column 0
+void meter_display_graph()
+{
+    shown_pages   = 0;  // The screen was cleared
+    graph_column  = 0;
+    OLED_setFont(&OLED_FONT_5x8);
+    OLED_setCursor(0, 0);
+    OLED_print("LOG");
+    OLED_setCursor(0, 118);
+    OLED_write('A');
+}
+
+// Graph row of a current, 0 below 1 uA
+uint8_t meter_graph_row(int32_t current)
+{
+    uint8_t low  = 0;
+    uint8_t high = sizeof(graph_levels_uA) / sizeof(graph_levels_uA[0]);
+    uint8_t mid;
+
+    if (current <= 0)
+    {
+        return 0;
+    }
+
+    // Binary search for the number of levels at or below the current
+    while (low < high)
+    {
+        mid = (low + high) >> 1;
+        if ((uint32_t)current >= graph_levels_uA[mid])
         {
-            min_current_uA = current_uA;
+            low = mid + 1;
         }
+        else
+        {
+            high = mid;
+        }
+    }
 
-        OLED_setFont(&OLED_FONT_8x16);
-        print_reading(0, 27, 112, bus_voltage_mV * 1000);
-        print_reading(2, 27, 112, current_uA);
-        print_reading(4, 27, 112, power_uW);
-        OLED_setFont(&OLED_FONT_5x8);
-        print_reading(6, 47, 112, max_current_uA);
-        print_reading(7, 47, 112, min_current_uA);
+    return low;
+}
+
+// Draw the rows low to high at the graph cursor and blank the column after it.
+void meter_draw_graph_column(uint8_t low, uint8_t high)
+{
+    __xdata uint8_t column[METER_GRAPH_PAGES];
+    uint8_t         row   = METER_GRAPH_PAGES * 8;  // Rows count up from the bottom
+    __bit           marks = (graph_column & (METER_GRAPH_DECADE - 1)) == 0;
+
+    for (uint8_t page = 0; page < METER_GRAPH_PAGES; page++)
+    {
+        uint8_t bits = 0;
+
+        // Bit 0 is the top row of a page
+        for (uint8_t mask = 1; mask; mask <<= 1)
+        {
+            --row;
+            if ((row >= low && row <= high) || (marks && (row & (METER_GRAPH_DECADE - 1)) == 0))
+            {
+                bits |= mask;
+            }
+        }
+        column[page] = bits;
+    }
+    OLED_plotColumn(graph_column, METER_GRAPH_PAGE, column, METER_GRAPH_PAGES);
+
+    graph_column = (graph_column + 1) & 127;
+    for (uint8_t page = 0; page < METER_GRAPH_PAGES; page++)
+    {
+        column[page] = 0;
+    }
+    OLED_plotColumn(graph_column, METER_GRAPH_PAGE, column, METER_GRAPH_PAGES);
+}
+
+// Average power of the accumulated samples, see INA219_get_power_product()
+// - Per shunt, the 40-bit sum x 2 / (the power divisor x the count) by long division,
+//   41 shift and subtract steps, the last one shifts in the x 2. At the display rate only.
+// - The sums are shifted out to 0.
+int32_t meter_average_power_uW()
+{
+    uint32_t power = 0;
+    uint32_t divisor, quotient, remainder;
+
+    for (uint8_t s = 0; s < 3; s++)
+    {
+        divisor   = (uint32_t)INA219_get_power_divisor(s) * averaged_samples;  // At most 500 x 512
+        quotient  = 0;
+        remainder = 0;
+        for (uint8_t i = 41; i; i--)
+        {
+            remainder = (remainder << 1) | (sum_power_high[s] >> 7);
+            sum_power_high[s] = (sum_power_high[s] << 1) | (uint8_t)(sum_power[s] >> 31);
+            sum_power[s] <<= 1;
+            quotient <<= 1;
+            if (remainder >= divisor)
+            {
+                remainder -= divisor;
+                quotient |= 1;
+            }
+        }
+        power += quotient;
+    }
+
+    return (int32_t)power;  // At most 107 W
+}
+
+// Display task, runs every METER_DISPLAY_INTERVAL_ms
+// - Rail 0 shows the average of the samples since the last refresh, the power is the
+//   average of the power of each sample, see meter_average_power_uW().
+// - Nothing new for rail 0 under undervoltage or between low power samples, its rows
+//   are left as they are.
+void meter_display_readings()
+{
+    if (averaged_samples && !undervoltage)
+    {
+        rail_bus_voltage_mV[0] = sum_bus_voltage_mV / averaged_samples;
+        rail_current_uA[0]     = sum_current_uA / averaged_samples;
+        power_uW               = meter_average_power_uW();  // Clears the power sum
+        sum_bus_voltage_mV     = 0;
+        sum_current_uA         = 0;
+        averaged_samples       = 0;
+
+        if (view == METER_VIEW_MAIN)
+        {
+            OLED_setFont(&OLED_FONT_8x16);
+            print_reading(0, 27, 112, 'V', rail_bus_voltage_mV[0] * 1000, METER_DEADBAND_uV);
+            print_big_reading(2, 27, 112, 'A', rail_current_uA[0], METER_DEADBAND_uA);
+            OLED_setFont(&OLED_FONT_5x8);
+            print_reading(5, 47, 112, 'W', power_uW, METER_DEADBAND_uW);
+            print_reading(6, 47, 112, 'A', max_current_uA, METER_DEADBAND_EXTREMES_uA);
+            print_reading(7, 47, 112, 'A', min_current_uA, METER_DEADBAND_EXTREMES_uA);
+        }
+        else if (view == METER_VIEW_GRAPH)
+        {
+            OLED_setFont(&OLED_FONT_5x8);
+            print_reading(0, 47, 112, 'A', rail_current_uA[0], METER_DEADBAND_uA);
+
+            meter_draw_graph_column(meter_graph_row(interval_min_uA), meter_graph_row(interval_max_uA));
+        }
     }
+
+    if (view == METER_VIEW_RAILS)
+    {
+        for (uint8_t i = 0; i < METER_RAILS; i++)
+        {
+            meter_display_rail(i);
+        }
+    }
+    else if (view == METER_VIEW_DIAG)
+    {
+        meter_display_counters();
+    }
+}
+
+// Acquisition at the conversion rate, the display at METER_DISPLAY_RATE_Hz
+void meter_run()
+{
+#if METER_RAILS > 1
+    // Round-robin, one rail per call
+    if (++rail == METER_RAILS)
+    {
+        rail = 0;
+    }
+
+    if (rail)
+    {
+        meter_run_rail(rail);
+    }
+#endif
+
+    if (rail == 0 && (sample_pending || meter_sample()))
+    {
+        sample_pending = 0;
+
+        // The shunt and the lockout follow every sample, both may draw.
+        if (undervoltage)
+        {
+            if (!locked_out)
+            {
+                locked_out = 1;
+                meter_undervoltage_lockout();
+            }
+        }
+        else
+        {
+            locked_out = 0;
+            meter_check_shunt();
+        }
+    }
+
+    if (shunt_pending)
+    {
+        shunt_pending = 0;
+        if (view == METER_VIEW_MAIN)
+        {
+            meter_display_shunt();
+        }
+    }
+
+    if (millis() - last_display_time >= METER_DISPLAY_INTERVAL_ms)
+    {
+        last_display_time = millis();
+        meter_display_readings();
+    }
+}
+
+// Switch to the next view: main, graph, rails with more than 1 rail, then diagnostics
+void meter_next_view()
+{
+    ++view;
+#if METER_RAILS == 1
+    if (view == METER_VIEW_RAILS)
+    {
+        view = METER_VIEW_DIAG;
+    }
+#endif
+    if (view > METER_VIEW_DIAG)
+    {
+        view = METER_VIEW_MAIN;
+    }
+
+    OLED_clear();
+    if (view == METER_VIEW_MAIN)
+    {
+        meter_display();
+    }
+    else if (view == METER_VIEW_GRAPH)
+    {
+        meter_display_graph();
+    }
+    else if (view == METER_VIEW_RAILS)
+    {
+        meter_display_rails();
+    }
+    else
+    {
+        meter_display_diag();
+    }
+}
+
+// Calibration
+#define STR(x)  #x
+#define XSTR(x) STR(x)
+
+__code char str_cal_loads[][14] = {
+    "LOAD " XSTR(METER_CAL_LOAD_Ohm_0) " OHM",
+    "LOAD " XSTR(METER_CAL_LOAD_Ohm_1) " OHM",
+    "LOAD " XSTR(METER_CAL_LOAD_Ohm_2) " OHM",
+};
+__code const uint16_t cal_loads_Ohm[] = {METER_CAL_LOAD_Ohm_0, METER_CAL_LOAD_Ohm_1, METER_CAL_LOAD_Ohm_2};
+
+__data int32_t cal_shunt_uV;    // Sum of METER_CAL_SAMPLES conversions
+__data int32_t cal_current_uA;  // Sum of METER_CAL_SAMPLES conversions
+__data int32_t cal_bus_mV;      // Sum of METER_CAL_SAMPLES conversions
+
+// Show a calibration step and wait for a press of the reset button
+void meter_calibration_prompt(uint8_t to_shunt, const char* str)
+{
+    OLED_clear();
+    meter_display_shunt();
+    OLED_setCursor(0, 16);
+    OLED_print("CALIBRATE");
+    OLED_setCursor(2, 0);
+    OLED_print(str);
+    OLED_setCursor(4, 0);
+    OLED_print("THEN PRESS");
+    OLED_setCursor(6, 0);
+    OLED_print("SHUNT");
+    OLED_setCursor(6, 48);
+    OLED_write('0' + to_shunt);
+
+    while (PIN_read(RESET_PIN))
+        ;
+    delay(20);  // Debounce
+    while (!PIN_read(RESET_PIN))
+        ;
+    delay(20);
+
+    OLED_setCursor(4, 0);
+    OLED_print("MEASURING ");
+}
+
+// Enable a shunt resistor, the new one is enabled before the others are disabled.
+void meter_enable_shunt(uint8_t to_shunt)
+{
+    if (to_shunt == 0)
+    {
+        PIN_high(SHUNT0_EN);
+        PIN_low(SHUNT1_EN);
+        PIN_low(SHUNT2_EN);
+    }
+    else if (to_shunt == 1)
+    {
+        PIN_high(SHUNT1_EN);
+        PIN_low(SHUNT0_EN);
+        PIN_low(SHUNT2_EN);
+    }
+    else
+    {
+        PIN_high(SHUNT2_EN);
+        PIN_low(SHUNT0_EN);
+        PIN_low(SHUNT1_EN);
+    }
+    meter_switch_to_shunt(to_shunt);
+}
+
+// Sum METER_CAL_SAMPLES conversions of rail 0 with the trim of the shunt applied
+void meter_calibration_sample()
+{
+    cal_shunt_uV   = 0;
+    cal_current_uA = 0;
+    cal_bus_mV     = 0;
+
+    for (uint8_t i = 0; i < METER_CAL_SAMPLES;)
+    {
+        if (INA219_conversion_ready())
+        {
+            cal_shunt_uV += INA219_get_shunt_voltage_uV();
+            INA219_clear_conversion_ready();
+            cal_current_uA += INA219_get_current_uA();
+            cal_bus_mV += INA219_get_latched_bus_voltage_mV();
+            if (discard_conversion)  // See meter_select_shunt()
+            {
+                discard_conversion = 0;
+                cal_shunt_uV       = 0;
+                cal_current_uA     = 0;
+                cal_bus_mV         = 0;
+                continue;
+            }
+            i++;
+        }
+    }
+}
+
+// Calibrate the gain error of a shunt, return 0 if the reading is out of the trim range.
+// - The reference current is the bus voltage / the reference load.
+// - Gain = (Reference - Measured) / Measured in Q15, |Gain| <= INA219_TRIM_GAIN_MAX.
+__bit meter_calibrate_gain(uint8_t to_shunt)
+{
+    int32_t measured = cal_current_uA;
+    int32_t diff     = cal_bus_mV * 1000 / cal_loads_Ohm[to_shunt] - measured;
+
+    if (measured <= 0 || INA219_overflow() || diff > measured / (INA219_TRIM_GAIN_ONE / INA219_TRIM_GAIN_MAX) ||
+        diff < -measured / (INA219_TRIM_GAIN_ONE / INA219_TRIM_GAIN_MAX))
+    {
+        return 0;
+    }
+
+    // Keep |diff| < 2^15, so diff x 2^15 fits in int32_t.
+    while (measured >= 0x80000)
+    {
+        measured >>= 1;
+        diff >>= 1;
+    }
+    trims[to_shunt].gain = (int16_t)(diff * INA219_TRIM_GAIN_ONE / measured);
+
+    return 1;
+}
+
+// On-device calibration of the trims of rail 0 against a reference load
+// 1. Without a load, the average shunt voltage of each shunt is its offset.
+// 2. With the reference load of each shunt, the gain error is trimmed so the current
+//    matches the bus voltage / the reference load.
+// 3. The trims are saved to the data flash.
+void meter_calibrate()
+{
+    __bit ok = 1;
+
+    while (!PIN_read(RESET_PIN))  // Wait for the button held at power-up to be released
+        ;
+    delay(20);
+
+#ifdef METER_LOW_POWER
+    INA219_set_mode(INA219_CONFIG_MODE_BOTH_CONTINUOUS);
+#endif
+
+    meter_calibration_prompt(0, "REMOVE LOAD");
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        trims[i].gain   = 0;
+        trims[i].offset = 0;
+        meter_enable_shunt(i);
+        meter_calibration_sample();
+
+        // Round to the nearest shunt voltage register LSB
+        cal_shunt_uV += cal_shunt_uV < 0 ? -(METER_CAL_SAMPLES * INA219_SHUNT_VOLTAGE_LSB_uV / 2)
+                                          : METER_CAL_SAMPLES * INA219_SHUNT_VOLTAGE_LSB_uV / 2;
+        trims[i].offset = (int16_t)(cal_shunt_uV / (METER_CAL_SAMPLES * INA219_SHUNT_VOLTAGE_LSB_uV));
+    }
+
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        meter_enable_shunt(0);  // The reference load may be too large for shunt 1 and 2
+        meter_calibration_prompt(i, str_cal_loads[i]);
+        meter_enable_shunt(i);  // The offset is applied
+        meter_calibration_sample();
+        if (!meter_calibrate_gain(i))
+        {
+            ok = 0;
+        }
+    }
+
+    meter_enable_shunt(0);
+    OLED_setCursor(4, 0);
+    if (ok && meter_save_trims())
+    {
+        OLED_print("SAVED     ");
+    }
+    else
+    {
+        meter_load_trims();  // Keep the trims in the data flash
+        meter_switch_to_shunt(0);
+        OLED_print("FAILED    ");
+    }
+    delay(1000);
+    resync_conversion = 1;  // No conversion was consumed during the prompts and the delay
+
+#ifdef METER_LOW_POWER
+    INA219_set_mode(INA219_CONFIG_MODE_POWER_DOWN);
+#endif
 }
@@ -1,10 +1,92 @@
 #pragma once
 
+#include <stdint.h>
+
 #define SHUNT0_EN P30
 #define SHUNT1_EN P31
 #define SHUNT2_EN P32
+#define RESET_PIN P34
+
+// Sampling mode
+// - Defined:   poll the INA219 Conversion Ready (CNVR) bit and consume every conversion exactly once.
+// - Undefined: sample every 20 ms, conversions read more than once are counted as duplicated.
+#define METER_SAMPLING_CONVERSION_READY
+
+// Shunt-only streaming for transient capture
+// - Defined:   run the INA219 in shunt-only continuous mode and read the shunt voltage with
+//              read-only transactions, the bus voltage is refreshed every METER_BUS_REFRESH_SAMPLES.
+// - Undefined: convert and read both shunt and bus voltage every sample.
+// #define METER_SHUNT_STREAMING
+#define METER_BUS_REFRESH_SAMPLES 32
+
+// Low duty cycle sampling for battery-powered DUTs
+// - Defined:   trigger a single-shot conversion every METER_LOW_POWER_INTERVAL_ms, power down
+//              the INA219 after each conversion, and idle the MCU between timer0 ticks.
+//              The MCU awake duty cycle is shown below the ADC profile.
+// - Undefined: run the INA219 continuously and the MCU at full speed.
+// #define METER_LOW_POWER
+#define METER_LOW_POWER_INTERVAL_ms 1000
+
+// Display refresh, 2 to 10 Hz, independent of the sampling rate
+// - Rail 0 is sampled at the conversion rate, every sample counts for MAX and MIN and for
+//   the shunt selection. The readings show the average over each display interval.
+#define METER_DISPLAY_RATE_Hz 4
+
+// Rails, the number of INA219s on the I2C bus including the on-board one, 1 to 4
+// - Sampled round-robin, see rail_addrs[] and rail_names[] in meter.c.
+// - A long press of the reset button switches between the main view, the graph view,
+//   with more than 1 rail the rails view, and the diagnostics view.
+#define METER_RAILS 1
+
+// Display deadband per row, in the unit of the reading
+// - A row is formatted and sent only when its reading moves by more than the deadband from
+//   the reading shown, 0 redraws on any change. Unchanged rows always cost nothing.
+// - At most 65535, rows within the deadband may lag the reading by up to this much.
+#define METER_DEADBAND_uV          0  // Bus voltage, main and rails views
+#define METER_DEADBAND_uA          0  // Current, main and rails views
+#define METER_DEADBAND_uW          0  // Power
+#define METER_DEADBAND_EXTREMES_uA 0  // MAX and MIN
+
+// Calibration of the per-shunt gain and offset trim, stored in the data flash
+// - Hold the reset button at power-up to start, then follow the prompts: remove the load
+//   for the offsets, then connect the reference load of each shunt for the gains.
+// - The reference current is the bus voltage / the reference load, choose loads that
+//   draw a current within the range of the shunt, e.g. 100-400 mA, 10-80 mA and 1-8 mA at 5 V.
+#define METER_CAL_LOAD_Ohm_0 20    // Shunt 0, 250 mA at 5 V, 1.25 W
+#define METER_CAL_LOAD_Ohm_1 100   // Shunt 1,  50 mA at 5 V
+#define METER_CAL_LOAD_Ohm_2 1000  // Shunt 2,   5 mA at 5 V
+#define METER_CAL_SAMPLES    16    // Conversions averaged per step, a power of 2
+
+#if METER_RAILS < 1 || METER_RAILS > 4
+#error METER_RAILS must be 1 to 4
+#endif
+
+#if METER_DISPLAY_RATE_Hz < 2 || METER_DISPLAY_RATE_Hz > 10
+#error METER_DISPLAY_RATE_Hz must be 2 to 10
+#endif
+
+#if METER_BUS_REFRESH_SAMPLES < 1 || METER_BUS_REFRESH_SAMPLES > 254
+#error METER_BUS_REFRESH_SAMPLES must be 1 to 254
+#endif
+
+#if defined(METER_SHUNT_STREAMING) && !defined(METER_SAMPLING_CONVERSION_READY)
+#error METER_SHUNT_STREAMING requires METER_SAMPLING_CONVERSION_READY
+#endif
+
+#if defined(METER_LOW_POWER) && (defined(METER_SHUNT_STREAMING) || !defined(METER_SAMPLING_CONVERSION_READY))
+#error METER_LOW_POWER requires METER_SAMPLING_CONVERSION_READY and excludes METER_SHUNT_STREAMING
+#endif
 
 void meter_init();
 void meter_reset();
 void meter_display();
 void meter_run();
+void meter_service();
+void meter_change_profile(int8_t steps);
+void meter_next_view();
+void meter_calibrate();
+
+uint16_t meter_get_dropped_conversions();
+uint16_t meter_get_duplicated_conversions();
+uint16_t meter_get_bus_retries();
+uint16_t meter_get_bus_errors();